@@ -0,0 +1,690 @@
+#include "async_client.hxx"
+#include "file_process.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr std::size_t SESSION_BUF_SIZE{256 << 10};
+constexpr int MAX_EVENTS{64};
+
+// A download lands in a temporary file next to its target and only
+// replaces the target once it is complete; otherwise it is removed.
+class partial_download
+{
+private:
+    std::string m_path;
+
+public:
+    explicit partial_download(std::string path) : m_path{std::move(path)} {}
+    partial_download(const partial_download &) = delete;
+    partial_download &operator=(const partial_download &) = delete;
+    ~partial_download()
+    {
+        if (!m_path.empty())
+            ::unlink(m_path.c_str());
+    }
+
+    [[nodiscard]] bool commit(const std::string &target)
+    {
+        if (std::rename(m_path.c_str(), target.c_str()) != 0)
+            return false;
+        m_path.clear();
+        return true;
+    }
+};
+
+namespace myftp
+{
+    event_loop::event_loop() : m_epoll_fd{::epoll_create1(EPOLL_CLOEXEC)}
+    {
+        if (m_epoll_fd < 0)
+            throw std::runtime_error{"Function `epoll_create1' error"};
+    }
+
+    event_loop::~event_loop() { file_process::close(m_epoll_fd); }
+
+    void event_loop::fd_awaiter::await_suspend(std::coroutine_handle<> handle)
+    {
+        epoll_event event{};
+        event.events = events | EPOLLONESHOT;
+        event.data.fd = fd;
+
+        auto it{std::find(loop.m_registered.begin(), loop.m_registered.end(),
+                          fd)};
+        int op{it == loop.m_registered.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD};
+        if (op == EPOLL_CTL_ADD)
+            loop.m_registered.push_back(fd);
+
+        loop.m_waiters[fd] = handle;
+        if (::epoll_ctl(loop.m_epoll_fd, op, fd, &event) < 0)
+        {
+            loop.m_waiters.erase(fd);
+            throw std::runtime_error{"Function `epoll_ctl' error"};
+        }
+    }
+
+    detail::detached event_loop::run_detached(event_loop &loop,
+                                              task<void> work)
+    {
+        co_await work;
+        --loop.m_pending;
+    }
+
+    static detail::detached run_joined(detail::join_counter &counter,
+                                       task<void> work)
+    {
+        co_await work;
+        if (--counter.remaining == 0 && counter.waiter)
+            counter.waiter.resume();
+    }
+
+    task<void> when_all(std::vector<task<void>> tasks)
+    {
+        detail::join_counter counter{tasks.size() + 1, {}};
+        for (task<void> &work : tasks)
+            run_joined(counter, std::move(work));
+        co_await counter;
+    }
+
+    void event_loop::spawn(task<void> work)
+    {
+        ++m_pending;
+        run_detached(*this, std::move(work));
+    }
+
+    void event_loop::run()
+    {
+        epoll_event events[MAX_EVENTS];
+        while (m_pending > 0 && !m_waiters.empty())
+        {
+            int n{::epoll_wait(m_epoll_fd, events, MAX_EVENTS, -1)};
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error{"Function `epoll_wait' error"};
+            }
+
+            for (int i{0}; i < n; ++i)
+            {
+                auto it{m_waiters.find(events[i].data.fd)};
+                if (it == m_waiters.end())
+                    continue;
+                auto handle{it->second};
+                m_waiters.erase(it);
+                handle.resume();
+            }
+        }
+    }
+
+    event_loop::fd_awaiter event_loop::readable(int fd)
+    {
+        return {*this, fd, EPOLLIN};
+    }
+
+    event_loop::fd_awaiter event_loop::writable(int fd)
+    {
+        return {*this, fd, EPOLLOUT};
+    }
+
+    void event_loop::forget(int fd)
+    {
+        auto it{std::find(m_registered.begin(), m_registered.end(), fd)};
+        if (it == m_registered.end())
+            return;
+        ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        m_registered.erase(it);
+        m_waiters.erase(fd);
+    }
+
+    session::session(event_loop &loop, int fd)
+        : m_loop{&loop}, m_fd{fd}, m_buf(SESSION_BUF_SIZE)
+    {
+    }
+
+    session::session(session &&other) noexcept
+        : m_loop{other.m_loop}, m_fd{std::exchange(other.m_fd, -1)},
+          m_buf{std::move(other.m_buf)}
+    {
+    }
+
+    session &session::operator=(session &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_loop = other.m_loop;
+            m_fd = std::exchange(other.m_fd, -1);
+            m_buf = std::move(other.m_buf);
+        }
+        return *this;
+    }
+
+    session::~session() { close(); }
+
+    bool session::is_open() const { return m_fd >= 0; }
+
+    void session::close()
+    {
+        if (m_fd < 0)
+            return;
+        m_loop->forget(m_fd);
+        file_process::close(m_fd);
+        m_fd = -1;
+    }
+
+    task<bool> session::read_exact(void *data, std::size_t size)
+    {
+        auto bytes{static_cast<char *>(data)};
+        while (size > 0)
+        {
+            ssize_t n{::read(m_fd, bytes, size)};
+            if (n > 0)
+            {
+                bytes += n;
+                size -= n;
+            }
+            else if (n == 0)
+                co_return false;
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                co_await m_loop->readable(m_fd);
+            else if (errno != EINTR)
+                co_return false;
+        }
+        co_return true;
+    }
+
+    task<bool> session::write_all(const void *data, std::size_t size)
+    {
+        auto bytes{static_cast<const char *>(data)};
+        while (size > 0)
+        {
+            ssize_t n{::send(m_fd, bytes, size, MSG_NOSIGNAL)};
+            if (n >= 0)
+            {
+                bytes += n;
+                size -= n;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                co_await m_loop->writable(m_fd);
+            else if (errno != EINTR)
+                co_return false;
+        }
+        co_return true;
+    }
+
+    task<bool> session::send_request(MYFTP_HEAD_TYPE type,
+                                     std::uint8_t status,
+                                     std::string_view name)
+    {
+        if (MYFTP_HEAD_SIZE + name.size() + 1 > m_buf.size())
+            co_return false;
+
+        myftp_head head(type, status, MYFTP_HEAD_SIZE + name.size() + 1);
+        std::memcpy(m_buf.data(), &head, MYFTP_HEAD_SIZE);
+        std::memcpy(m_buf.data() + MYFTP_HEAD_SIZE, name.data(), name.size());
+        m_buf[MYFTP_HEAD_SIZE + name.size()] = '\0';
+        co_return co_await write_all(m_buf.data(),
+                                     MYFTP_HEAD_SIZE + name.size() + 1);
+    }
+
+    task<bool> session::read_head(MYFTP_HEAD_TYPE type, myftp_head_view &head)
+    {
+        myftp_head raw;
+        if (!co_await read_exact(&raw, MYFTP_HEAD_SIZE))
+            co_return false;
+        head = raw.parse();
+        co_return head.type == type;
+    }
+
+    task<std::optional<std::string>> session::read_text(std::size_t size)
+    {
+        std::string text(size, '\0');
+        if (!co_await read_exact(text.data(), size))
+            co_return std::nullopt;
+        if (!text.empty() && text.back() == '\0')
+            text.pop_back();
+        co_return text;
+    }
+
+    task<bool> session::receive_sparse(int file_fd,
+                                       std::size_t payload_length,
+                                       sha256_hasher *hasher, bool &is_written)
+    {
+        char fixed[SPARSE_HEADER_SIZE];
+        sparse_map map;
+        std::uint32_t n_extents;
+        if (!co_await read_exact(fixed, SPARSE_HEADER_SIZE) ||
+            !decode_sparse_header(fixed, map.logical_size, n_extents))
+            co_return false;
+
+        std::string table(SPARSE_EXTENT_SIZE * n_extents, '\0');
+        if (!co_await read_exact(table.data(), table.size()) ||
+            !decode_sparse_extents(table.data(), n_extents, payload_length,
+                                   map))
+            co_return false;
+
+        if (is_written)
+            is_written = ::ftruncate(file_fd, map.logical_size) == 0;
+
+        std::uint64_t end{0};
+        for (const file_extent &extent : map.extents)
+        {
+            if (hasher)
+                hash_zeros(*hasher, extent.offset - end);
+
+            for (std::uint64_t done{0}; done < extent.length;)
+            {
+                std::size_t length{static_cast<std::size_t>(
+                    std::min<std::uint64_t>(m_buf.size(),
+                                            extent.length - done))};
+                if (!co_await read_exact(m_buf.data(), length))
+                    co_return false;
+                if (hasher)
+                    hasher->update(m_buf.data(), length);
+                if (is_written)
+                    is_written = ::pwrite(file_fd, m_buf.data(), length,
+                                          extent.offset + done) ==
+                                 static_cast<ssize_t>(length);
+                done += length;
+            }
+            end = extent.offset + extent.length;
+        }
+
+        if (hasher)
+            hash_zeros(*hasher, map.logical_size - end);
+        co_return true;
+    }
+
+    task<bool> session::send_sparse(int file_fd, const sparse_map &map,
+                                    sha256_hasher *hasher)
+    {
+        myftp_head head(MYFTP_HEAD_TYPE::SPARSE_DATA, 1,
+                        static_cast<std::uint32_t>(map.frame_size()));
+        std::string header(reinterpret_cast<const char *>(&head),
+                           MYFTP_HEAD_SIZE);
+        map.encode(header);
+        if (!co_await write_all(header.data(), header.size()))
+            co_return false;
+
+        std::uint64_t end{0};
+        for (const file_extent &extent : map.extents)
+        {
+            if (hasher)
+                hash_zeros(*hasher, extent.offset - end);
+
+            for (std::uint64_t done{0}; done < extent.length;)
+            {
+                std::size_t length{static_cast<std::size_t>(
+                    std::min<std::uint64_t>(m_buf.size(),
+                                            extent.length - done))};
+                ssize_t n_read{::pread(file_fd, m_buf.data(), length,
+                                       extent.offset + done)};
+                if (n_read <= 0)
+                    co_return false;
+                if (hasher)
+                    hasher->update(m_buf.data(), n_read);
+                if (!co_await write_all(m_buf.data(), n_read))
+                    co_return false;
+                done += n_read;
+            }
+            end = extent.offset + extent.length;
+        }
+
+        if (hasher)
+            hash_zeros(*hasher, map.logical_size - end);
+        co_return true;
+    }
+
+    task<std::optional<session>> session::open(event_loop &loop,
+                                               const char *host,
+                                               const char *port)
+    {
+        addrinfo hints{}, *list;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+        if (::getaddrinfo(host, port, &hints, &list) != 0)
+            co_return std::nullopt;
+
+        int fd{-1};
+        bool is_pending{false};
+        for (addrinfo *p{list}; p; p = p->ai_next)
+        {
+            fd = ::socket(p->ai_family,
+                          p->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          p->ai_protocol);
+            if (fd < 0)
+                continue;
+            if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0 ||
+                (is_pending = errno == EINPROGRESS))
+                break;
+            file_process::close(fd);
+            fd = -1;
+        }
+        ::freeaddrinfo(list);
+        if (fd < 0)
+            co_return std::nullopt;
+
+        int optval{1};
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(int));
+
+        session result{loop, fd};
+        if (is_pending)
+        {
+            co_await loop.writable(fd);
+            int error{0};
+            socklen_t length{sizeof(error)};
+            if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 ||
+                error != 0)
+                co_return std::nullopt;
+        }
+
+        myftp_head_view head;
+        if (!co_await result.write_all(&OPEN_CONNECTION_REQUEST,
+                                       MYFTP_HEAD_SIZE) ||
+            !co_await result.read_head(MYFTP_HEAD_TYPE::OPEN_CONNECTION_REPLY,
+                                       head))
+            co_return std::nullopt;
+
+        co_return std::optional<session>{std::move(result)};
+    }
+
+    task<std::optional<std::string>> session::list()
+    {
+        myftp_head_view head;
+        if (!co_await write_all(&LIST_REQUEST, MYFTP_HEAD_SIZE) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::LIST_REPLY, head))
+            co_return std::nullopt;
+        co_return co_await read_text(head.payload_length());
+    }
+
+    task<std::optional<std::vector<file_meta>>>
+    session::meta_list(std::string prefix, bool recursive)
+    {
+        std::uint8_t status{static_cast<std::uint8_t>(
+            recursive ? 1 | MYFTP_FLAG_RECURSIVE : 1)};
+
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::META_LIST_REQUEST, status,
+                                   prefix) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::META_LIST_REPLY, head))
+            co_return std::nullopt;
+
+        std::string payload(head.payload_length(), '\0');
+        if (!co_await read_exact(payload.data(), payload.size()) ||
+            head.status != 1)
+            co_return std::nullopt;
+
+        std::vector<file_meta> records;
+        if (!parse_file_meta(payload, records))
+            co_return std::nullopt;
+        co_return records;
+    }
+
+    task<std::optional<std::string>> session::stats()
+    {
+        myftp_head_view head;
+        if (!co_await write_all(&STATS_REQUEST, MYFTP_HEAD_SIZE) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::STATS_REPLY, head))
+            co_return std::nullopt;
+        co_return co_await read_text(head.payload_length());
+    }
+
+    task<text_reply> session::sha256(std::string remote_path,
+                                     std::uint8_t flags)
+    {
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::SHA_REQUEST, flags,
+                                   remote_path) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::SHA_REPLY, head))
+            co_return text_reply{TRANSFER_STATUS::ERROR, {}};
+        if (head.status != 1)
+            co_return text_reply{TRANSFER_STATUS::NOT_FOUND, {}};
+
+        if (!co_await read_head(MYFTP_HEAD_TYPE::FILE_DATA, head))
+            co_return text_reply{TRANSFER_STATUS::ERROR, {}};
+        auto text{co_await read_text(head.payload_length())};
+        if (!text)
+            co_return text_reply{TRANSFER_STATUS::ERROR, {}};
+        co_return text_reply{TRANSFER_STATUS::OK, std::move(*text)};
+    }
+
+    task<std::optional<std::vector<file_digest>>>
+    session::sha256_batch(std::vector<std::string> patterns)
+    {
+        std::string payload(MYFTP_HEAD_SIZE, '\0');
+        for (const std::string &pattern : patterns)
+        {
+            payload += pattern;
+            payload.push_back('\0');
+        }
+        if (payload.size() < MYFTP_HEAD_SIZE + 2 ||
+            payload.size() > MYFTP_HEAD_SIZE + MAX_SHA_BATCH_PAYLOAD)
+            co_return std::nullopt;
+
+        myftp_head request(MYFTP_HEAD_TYPE::SHA_BATCH_REQUEST, 1,
+                           payload.size());
+        std::memcpy(payload.data(), &request, MYFTP_HEAD_SIZE);
+
+        myftp_head_view head;
+        if (!co_await write_all(payload.data(), payload.size()) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::SHA_BATCH_REPLY, head) ||
+            head.status != 1)
+            co_return std::nullopt;
+
+        std::vector<file_digest> digests;
+        for (;;)
+        {
+            if (!co_await read_head(MYFTP_HEAD_TYPE::FILE_DATA, head))
+                co_return std::nullopt;
+            if (head.payload_length() == 0)
+                co_return digests;
+
+            std::string frame(head.payload_length(), '\0');
+            if (!co_await read_exact(frame.data(), frame.size()))
+                co_return std::nullopt;
+
+            file_digest entry;
+            if (head.status == 1)
+            {
+                if (frame.size() <= SHA256_DIGEST_SIZE)
+                    co_return std::nullopt;
+                entry.digest.emplace();
+                std::memcpy(entry.digest->data(), frame.data(),
+                            SHA256_DIGEST_SIZE);
+                frame.erase(0, SHA256_DIGEST_SIZE);
+            }
+            entry.name = std::move(frame);
+            digests.push_back(std::move(entry));
+        }
+    }
+
+    task<TRANSFER_STATUS> session::remove(std::string remote_path)
+    {
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::DELETE_REQUEST, 1,
+                                   remote_path) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::DELETE_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        co_return head.status == 1 ? TRANSFER_STATUS::OK
+                                   : TRANSFER_STATUS::NOT_FOUND;
+    }
+
+    task<TRANSFER_STATUS> session::copy(std::string source,
+                                        std::string target)
+    {
+        source.push_back('\0');
+        source += target;
+
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::COPY_REQUEST, 1, source) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::COPY_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        co_return head.status == 1 ? TRANSFER_STATUS::OK
+                                   : TRANSFER_STATUS::NOT_FOUND;
+    }
+
+    task<TRANSFER_STATUS> session::move(std::string source,
+                                        std::string target)
+    {
+        source.push_back('\0');
+        source += target;
+
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::MOVE_REQUEST, 1, source) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::MOVE_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        co_return head.status == 1 ? TRANSFER_STATUS::OK
+                                   : TRANSFER_STATUS::NOT_FOUND;
+    }
+
+    task<TRANSFER_STATUS> session::get(std::string remote_path,
+                                       std::string local_path, bool verify)
+    {
+        std::uint8_t status{static_cast<std::uint8_t>(
+            (verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1) | MYFTP_FLAG_SPARSE)};
+
+        myftp_head_view head{};
+        if (!co_await send_request(MYFTP_HEAD_TYPE::GET_REQUEST, status,
+                                   remote_path) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::GET_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        if (head.status != 1)
+            co_return TRANSFER_STATUS::NOT_FOUND;
+
+        head.type = MYFTP_HEAD_TYPE::INVALID;
+        bool is_dense{co_await read_head(MYFTP_HEAD_TYPE::FILE_DATA, head)};
+        if (!is_dense && head.type != MYFTP_HEAD_TYPE::SPARSE_DATA)
+            co_return TRANSFER_STATUS::ERROR;
+
+        std::string temporary_path;
+        file_descriptor file{
+            create_temporary_file(local_path, 0666, temporary_path)};
+        partial_download download{file.is_valid() ? temporary_path : ""};
+        sha256_hasher hasher;
+        bool is_written{file.is_valid()};
+
+        if (!is_dense &&
+            !co_await receive_sparse(file.get(), head.payload_length(),
+                                     verify ? &hasher : nullptr, is_written))
+            co_return TRANSFER_STATUS::ERROR;
+
+        for (std::size_t remain{is_dense ? head.payload_length() : 0};
+             remain > 0;)
+        {
+            std::size_t length{std::min(remain, m_buf.size())};
+            if (!co_await read_exact(m_buf.data(), length))
+                co_return TRANSFER_STATUS::ERROR;
+            if (verify)
+                hasher.update(m_buf.data(), length);
+            if (is_written)
+                is_written = file_process::write(file.get(), m_buf.data(),
+                                                 length) == length;
+            remain -= length;
+        }
+
+        bool is_matched{true};
+        if (verify)
+        {
+            myftp_digest_trailer trailer;
+            if (!co_await read_exact(&trailer, MYFTP_DIGEST_TRAILER_SIZE))
+                co_return TRANSFER_STATUS::ERROR;
+            is_matched = trailer.get_digest() == hasher.finish();
+        }
+
+        if (!is_written)
+            co_return TRANSFER_STATUS::ERROR;
+        if (!is_matched)
+            co_return TRANSFER_STATUS::DIGEST_MISMATCH;
+        co_return download.commit(local_path) ? TRANSFER_STATUS::OK
+                                              : TRANSFER_STATUS::ERROR;
+    }
+
+    task<TRANSFER_STATUS> session::put(std::string local_path,
+                                       std::string remote_path, bool verify)
+    {
+        file_descriptor file{::open(local_path.c_str(), O_RDONLY | O_CLOEXEC)};
+        struct stat file_stat;
+        if (!file.is_valid() || ::fstat(file.get(), &file_stat) != 0 ||
+            !S_ISREG(file_stat.st_mode))
+            co_return TRANSFER_STATUS::NOT_FOUND;
+
+        std::size_t file_size{static_cast<std::size_t>(file_stat.st_size)};
+        sparse_map map;
+        bool is_sparse_upload{is_sparse(file_stat) &&
+                              map_data_extents(file.get(), file_size, map)};
+
+        std::uint8_t status{static_cast<std::uint8_t>(
+            (verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1) |
+            (is_sparse_upload ? MYFTP_FLAG_SPARSE : 0))};
+
+        myftp_head_view head;
+        if (!co_await send_request(MYFTP_HEAD_TYPE::PUT_REQUEST, status,
+                                   remote_path) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::PUT_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        if (is_sparse_upload && !(head.status & MYFTP_FLAG_SPARSE))
+        {
+            is_sparse_upload = false;
+            if (::lseek(file.get(), 0, SEEK_SET) != 0)
+                co_return TRANSFER_STATUS::ERROR;
+        }
+
+        sha256_hasher hasher;
+        if (is_sparse_upload)
+        {
+            if (!co_await send_sparse(file.get(), map,
+                                      verify ? &hasher : nullptr))
+                co_return TRANSFER_STATUS::ERROR;
+            file_size = 0;
+        }
+        else
+        {
+            myftp_head file_data(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                                 MYFTP_HEAD_SIZE + file_size);
+            if (!co_await write_all(&file_data, MYFTP_HEAD_SIZE))
+                co_return TRANSFER_STATUS::ERROR;
+        }
+
+        for (std::size_t remain{file_size}; remain > 0;)
+        {
+            std::size_t length{std::min(remain, m_buf.size())};
+            if (file_process::read(file.get(), m_buf.data(), length) != length)
+                co_return TRANSFER_STATUS::ERROR;
+            if (verify)
+                hasher.update(m_buf.data(), length);
+            if (!co_await write_all(m_buf.data(), length))
+                co_return TRANSFER_STATUS::ERROR;
+            remain -= length;
+        }
+
+        if (!verify)
+            co_return TRANSFER_STATUS::OK;
+
+        myftp_digest_trailer trailer{hasher.finish()};
+        if (!co_await write_all(&trailer, MYFTP_DIGEST_TRAILER_SIZE) ||
+            !co_await read_head(MYFTP_HEAD_TYPE::PUT_REPLY, head))
+            co_return TRANSFER_STATUS::ERROR;
+        co_return head.status == 1 ? TRANSFER_STATUS::OK
+                                   : TRANSFER_STATUS::DIGEST_MISMATCH;
+    }
+
+    task<bool> session::quit()
+    {
+        myftp_head_view head;
+        bool is_ok{co_await write_all(&QUIT_REQUEST, MYFTP_HEAD_SIZE) &&
+                   co_await read_head(MYFTP_HEAD_TYPE::QUIT_REPLY, head)};
+        close();
+        co_return is_ok;
+    }
+}
@@ -0,0 +1,256 @@
+#ifndef ASYNC_CLIENT_HXX
+#define ASYNC_CLIENT_HXX
+
+#include "file_meta.hxx"
+#include "sparse_file.hxx"
+#include "tools.hxx"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace myftp
+{
+    template <typename T> class task;
+
+    namespace detail
+    {
+        struct promise_base
+        {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                template <typename P>
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<P> handle) noexcept
+                {
+                    auto continuation{handle.promise().continuation};
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            final_awaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception()
+            {
+                exception = std::current_exception();
+            }
+        };
+
+        template <typename T> struct promise : promise_base
+        {
+            std::optional<T> value;
+
+            task<T> get_return_object();
+            void return_value(T result) { value = std::move(result); }
+            T take()
+            {
+                if (exception)
+                    std::rethrow_exception(exception);
+                return std::move(*value);
+            }
+        };
+
+        template <> struct promise<void> : promise_base
+        {
+            task<void> get_return_object();
+            void return_void() {}
+            void take()
+            {
+                if (exception)
+                    std::rethrow_exception(exception);
+            }
+        };
+
+        struct detached
+        {
+            struct promise_type
+            {
+                detached get_return_object() { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+        };
+
+        struct join_counter
+        {
+            std::size_t remaining;
+            std::coroutine_handle<> waiter;
+
+            bool await_ready() noexcept { return --remaining == 0; }
+            void await_suspend(std::coroutine_handle<> handle) noexcept
+            {
+                waiter = handle;
+            }
+            void await_resume() noexcept {}
+        };
+    }
+
+    template <typename T = void> class [[nodiscard]] task
+    {
+    public:
+        using promise_type = detail::promise<T>;
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+
+    public:
+        explicit task(std::coroutine_handle<promise_type> handle)
+            : m_handle{handle}
+        {
+        }
+        task(task &&other) noexcept
+            : m_handle{std::exchange(other.m_handle, nullptr)}
+        {
+        }
+        task(const task &) = delete;
+        task &operator=(const task &) = delete;
+        ~task()
+        {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<> continuation) noexcept
+        {
+            m_handle.promise().continuation = continuation;
+            return m_handle;
+        }
+        T await_resume() { return m_handle.promise().take(); }
+    };
+
+    template <typename T> task<T> detail::promise<T>::get_return_object()
+    {
+        return task<T>{std::coroutine_handle<promise<T>>::from_promise(*this)};
+    }
+
+    inline task<void> detail::promise<void>::get_return_object()
+    {
+        return task<void>{
+            std::coroutine_handle<promise<void>>::from_promise(*this)};
+    }
+
+    class event_loop
+    {
+    private:
+        int m_epoll_fd;
+        std::size_t m_pending = 0;
+        std::unordered_map<int, std::coroutine_handle<>> m_waiters;
+        std::vector<int> m_registered;
+
+        struct fd_awaiter
+        {
+            event_loop &loop;
+            int fd;
+            std::uint32_t events;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle);
+            void await_resume() const noexcept {}
+        };
+
+        static detail::detached run_detached(event_loop &loop, task<void> work);
+
+    public:
+        event_loop();
+        event_loop(const event_loop &) = delete;
+        event_loop &operator=(const event_loop &) = delete;
+        ~event_loop();
+
+        void spawn(task<void> work);
+        void run();
+
+        fd_awaiter readable(int fd);
+        fd_awaiter writable(int fd);
+        void forget(int fd);
+    };
+
+    task<void> when_all(std::vector<task<void>> tasks);
+
+    enum class TRANSFER_STATUS
+    {
+        OK,
+        NOT_FOUND,
+        DIGEST_MISMATCH,
+        ERROR
+    };
+
+    struct text_reply
+    {
+        TRANSFER_STATUS status;
+        std::string text;
+    };
+
+    struct file_digest
+    {
+        std::string name;
+        std::optional<sha256_digest> digest;
+    };
+
+    class session
+    {
+    private:
+        event_loop *m_loop;
+        int m_fd;
+        std::vector<char> m_buf;
+
+        session(event_loop &loop, int fd);
+
+        task<bool> read_exact(void *data, std::size_t size);
+        task<bool> write_all(const void *data, std::size_t size);
+        task<bool> send_request(MYFTP_HEAD_TYPE type, std::uint8_t status,
+                                std::string_view name);
+        task<bool> read_head(MYFTP_HEAD_TYPE type, myftp_head_view &head);
+        task<std::optional<std::string>> read_text(std::size_t size);
+        task<bool> receive_sparse(int file_fd, std::size_t payload_length,
+                                  sha256_hasher *hasher, bool &is_written);
+        task<bool> send_sparse(int file_fd, const sparse_map &map,
+                               sha256_hasher *hasher);
+
+    public:
+        session(session &&other) noexcept;
+        session &operator=(session &&other) noexcept;
+        session(const session &) = delete;
+        session &operator=(const session &) = delete;
+        ~session();
+
+        static task<std::optional<session>>
+        open(event_loop &loop, const char *host, const char *port);
+
+        bool is_open() const;
+        void close();
+
+        task<std::optional<std::string>> list();
+        task<std::optional<std::vector<file_meta>>>
+        meta_list(std::string prefix = {}, bool recursive = false);
+        task<TRANSFER_STATUS> get(std::string remote_path,
+                                  std::string local_path, bool verify = false);
+        task<TRANSFER_STATUS> put(std::string local_path,
+                                  std::string remote_path, bool verify = false);
+        task<TRANSFER_STATUS> remove(std::string remote_path);
+        task<TRANSFER_STATUS> copy(std::string source, std::string target);
+        task<TRANSFER_STATUS> move(std::string source, std::string target);
+        task<text_reply> sha256(std::string remote_path,
+                                std::uint8_t flags = 1);
+        task<std::optional<std::vector<file_digest>>>
+        sha256_batch(std::vector<std::string> patterns);
+        task<std::optional<std::string>> stats();
+        task<bool> quit();
+    };
+}
+
+#endif
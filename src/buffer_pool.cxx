@@ -0,0 +1,145 @@
+#include "buffer_pool.hxx"
+#include <sched.h>
+#include <sys/mman.h>
+#include <utility>
+
+static std::size_t round_up(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static unsigned current_node()
+{
+    unsigned cpu, node;
+    if (::getcpu(&cpu, &node) != 0 || node >= MAX_NUMA_NODES)
+        return 0;
+    return node;
+}
+
+buffer_pool::lease::lease(buffer_pool *pool, char *data, unsigned node)
+    : m_pool{pool}, m_data{data}, m_node{node}
+{
+}
+
+buffer_pool::lease::lease(lease &&other) noexcept
+    : m_pool{std::exchange(other.m_pool, nullptr)},
+      m_data{std::exchange(other.m_data, nullptr)}, m_node{other.m_node}
+{
+}
+
+buffer_pool::lease &buffer_pool::lease::operator=(lease &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_data)
+            m_pool->release(m_data, m_node);
+        m_pool = std::exchange(other.m_pool, nullptr);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_node = other.m_node;
+    }
+    return *this;
+}
+
+buffer_pool::lease::~lease()
+{
+    if (m_data)
+        m_pool->release(m_data, m_node);
+}
+
+bool buffer_pool::lease::is_valid() const { return m_data != nullptr; }
+char *buffer_pool::lease::data() { return m_data; }
+std::size_t buffer_pool::lease::size() const
+{
+    return m_pool ? m_pool->buffer_size() : 0;
+}
+
+buffer_pool::buffer_pool(std::size_t buffer_size, std::size_t max_idle,
+                         bool huge_pages)
+    : m_buffer_size{round_up(buffer_size, BUFFER_ALIGNMENT)},
+      m_arena_size{round_up(m_buffer_size, HUGE_PAGE_SIZE)},
+      m_max_idle{max_idle}, m_huge_pages{huge_pages}
+{
+}
+
+buffer_pool::~buffer_pool()
+{
+    for (const auto &block : m_arenas)
+        ::munmap(block.data, block.size);
+}
+
+char *buffer_pool::allocate_arena(node_list &list)
+{
+    void *data{MAP_FAILED};
+    if (m_huge_pages)
+    {
+        data = ::mmap(nullptr, m_arena_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED)
+            m_huge_pages = false;
+    }
+    bool is_huge{data != MAP_FAILED};
+    if (data == MAP_FAILED)
+    {
+        data = ::mmap(nullptr, m_arena_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+            return nullptr;
+        ::madvise(data, m_arena_size, MADV_HUGEPAGE);
+    }
+
+    {
+        std::lock_guard lock{m_arena_mutex};
+        m_arenas.push_back({data, m_arena_size, is_huge});
+    }
+
+    auto base{static_cast<char *>(data)};
+    for (std::size_t offset{m_buffer_size};
+         offset + m_buffer_size <= m_arena_size; offset += m_buffer_size)
+        list.idle.push_back(base + offset);
+    return base;
+}
+
+bool buffer_pool::is_huge_page(const char *data)
+{
+    std::lock_guard lock{m_arena_mutex};
+    for (const auto &block : m_arenas)
+    {
+        auto base{static_cast<const char *>(block.data)};
+        if (data >= base && data < base + block.size)
+            return block.is_huge_page;
+    }
+    return false;
+}
+
+void buffer_pool::release(char *data, unsigned node)
+{
+    node_list &list{m_nodes[node]};
+    std::lock_guard lock{list.mutex};
+
+    if (list.idle.size() < m_max_idle)
+    {
+        list.idle.push_back(data);
+        return;
+    }
+
+    if (!is_huge_page(data))
+        ::madvise(data, m_buffer_size, MADV_DONTNEED);
+    list.idle.push_front(data);
+}
+
+[[nodiscard]] buffer_pool::lease buffer_pool::acquire()
+{
+    unsigned node{current_node()};
+    node_list &list{m_nodes[node]};
+    std::lock_guard lock{list.mutex};
+
+    if (list.idle.empty())
+        return {this, allocate_arena(list), node};
+
+    char *data{list.idle.back()};
+    list.idle.pop_back();
+    return {this, data, node};
+}
+
+std::size_t buffer_pool::buffer_size() const { return m_buffer_size; }
+bool buffer_pool::uses_huge_pages() const { return m_huge_pages; }
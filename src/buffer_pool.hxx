@@ -0,0 +1,78 @@
+#ifndef BUFFER_POOL_HXX
+#define BUFFER_POOL_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+constexpr std::size_t BUFFER_ALIGNMENT{4096};
+constexpr std::size_t HUGE_PAGE_SIZE{2 << 20};
+constexpr std::size_t MAX_NUMA_NODES{64};
+
+class buffer_pool
+{
+public:
+    class lease
+    {
+    private:
+        buffer_pool *m_pool = nullptr;
+        char *m_data = nullptr;
+        unsigned m_node = 0;
+
+    public:
+        lease(buffer_pool *pool, char *data, unsigned node);
+        lease(lease &&other) noexcept;
+        lease &operator=(lease &&other) noexcept;
+        lease(const lease &) = delete;
+        lease &operator=(const lease &) = delete;
+        ~lease();
+
+        bool is_valid() const;
+        char *data();
+        std::size_t size() const;
+    };
+
+private:
+    struct node_list
+    {
+        std::mutex mutex;
+        std::deque<char *> idle;
+    };
+
+    struct arena
+    {
+        void *data;
+        std::size_t size;
+        bool is_huge_page;
+    };
+
+    const std::size_t m_buffer_size;
+    const std::size_t m_arena_size;
+    const std::size_t m_max_idle;
+    std::atomic<bool> m_huge_pages;
+
+    std::array<node_list, MAX_NUMA_NODES> m_nodes;
+
+    std::mutex m_arena_mutex;
+    std::vector<arena> m_arenas;
+
+    void release(char *data, unsigned node);
+    bool is_huge_page(const char *data);
+    char *allocate_arena(node_list &list);
+
+public:
+    buffer_pool(std::size_t buffer_size, std::size_t max_idle,
+                bool huge_pages = false);
+    buffer_pool(const buffer_pool &) = delete;
+    buffer_pool &operator=(const buffer_pool &) = delete;
+    ~buffer_pool();
+
+    [[nodiscard]] lease acquire();
+    std::size_t buffer_size() const;
+    bool uses_huge_pages() const;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "command.hxx"
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+constexpr std::size_t MAX_COMMAND_TOKENS{3};
+constexpr std::size_t ANY_ARGS{static_cast<std::size_t>(-1)};
+
+struct command_rule
+{
+    std::string_view keyword;
+    COMMAND_TYPE type;
+    std::size_t min_args;
+    std::size_t max_args;
+};
+
+constexpr command_rule COMMAND_RULES[]{
+    {"open", COMMAND_TYPE::OPEN, 2, 2},
+    {"ls", COMMAND_TYPE::LIST, 0, 0},
+    {"lsl", COMMAND_TYPE::META_LIST, 0, 1},
+    {"lsr", COMMAND_TYPE::META_LIST_RECURSIVE, 0, 1},
+    {"get", COMMAND_TYPE::GET, 1, 1},
+    {"put", COMMAND_TYPE::PUT, 1, 1},
+    {"cp", COMMAND_TYPE::COPY, 2, 2},
+    {"mv", COMMAND_TYPE::MOVE, 2, 2},
+    {"sha256", COMMAND_TYPE::SHA, 1, 1},
+    {"shasum", COMMAND_TYPE::SHA_BATCH, 1, ANY_ARGS},
+    {"merkle", COMMAND_TYPE::MERKLE, 1, 1},
+    {"verify", COMMAND_TYPE::VERIFY, 1, 1},
+    {"sync", COMMAND_TYPE::SYNC, 0, 1},
+    {"stats", COMMAND_TYPE::STATS, 0, 0},
+    {"quit", COMMAND_TYPE::QUIT, 0, 0},
+};
+
+constexpr bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr bool is_hex_digit(char c)
+{
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static std::size_t
+tokenize(std::string_view command,
+         std::array<std::string_view, MAX_COMMAND_TOKENS> &tokens)
+{
+    std::size_t n_tokens{0};
+    for (std::size_t i{0}; i < command.size();)
+    {
+        if (is_space(command[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t begin{i};
+        while (i < command.size() && !is_space(command[i]))
+            ++i;
+        if (n_tokens == MAX_COMMAND_TOKENS)
+            return MAX_COMMAND_TOKENS + 1;
+        tokens[n_tokens++] = command.substr(begin, i - begin);
+    }
+    return n_tokens;
+}
+
+template <typename Predicate>
+static bool is_grouped(std::string_view text, char separator,
+                       std::size_t n_groups, std::size_t max_group_length,
+                       Predicate is_group_char)
+{
+    std::size_t groups{0}, length{0};
+    for (char c : text)
+    {
+        if (c == separator)
+        {
+            if (length == 0)
+                return false;
+            ++groups;
+            length = 0;
+        }
+        else if (!is_group_char(c) || ++length > max_group_length)
+            return false;
+    }
+    return length != 0 && groups + 1 == n_groups;
+}
+
+static bool is_ip(std::string_view text)
+{
+    return is_grouped(text, '.', 4, 3, is_digit) ||
+           is_grouped(text, ':', 8, 4, is_hex_digit);
+}
+
+static bool is_port(std::string_view text)
+{
+    if (text.empty())
+        return false;
+    for (char c : text)
+        if (!is_digit(c))
+            return false;
+    return true;
+}
+
+std::tuple<COMMAND_TYPE, std::string_view, std::string_view>
+parse_command(std::string_view command)
+{
+    constexpr std::tuple<COMMAND_TYPE, std::string_view, std::string_view>
+        INVALID{COMMAND_TYPE::INVALID, {}, {}};
+
+    std::array<std::string_view, MAX_COMMAND_TOKENS> tokens;
+    std::size_t n_tokens{tokenize(command, tokens)};
+    if (n_tokens == 0)
+        return INVALID;
+
+    for (const command_rule &rule : COMMAND_RULES)
+    {
+        if (rule.keyword != tokens[0])
+            continue;
+        if (n_tokens < rule.min_args + 1 ||
+            (rule.max_args != ANY_ARGS && n_tokens > rule.max_args + 1))
+            return INVALID;
+
+        if (rule.max_args == ANY_ARGS)
+        {
+            std::size_t begin{
+                static_cast<std::size_t>(tokens[1].data() - command.data())};
+            std::size_t end{command.size()};
+            while (is_space(command[end - 1]))
+                --end;
+            return {rule.type, command.substr(begin, end - begin), {}};
+        }
+
+        switch (rule.type)
+        {
+        case COMMAND_TYPE::OPEN:
+            if (!is_ip(tokens[1]) || !is_port(tokens[2]))
+                return INVALID;
+            break;
+        case COMMAND_TYPE::VERIFY:
+            if (tokens[1] != "on" && tokens[1] != "off")
+                return INVALID;
+            break;
+        default:
+            break;
+        }
+        return {rule.type, tokens[1], tokens[2]};
+    }
+
+    return INVALID;
+}
+
+std::vector<std::string_view> split_arguments(std::string_view arguments)
+{
+    std::vector<std::string_view> tokens;
+    for (std::size_t i{0}; i < arguments.size();)
+    {
+        if (is_space(arguments[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t begin{i};
+        while (i < arguments.size() && !is_space(arguments[i]))
+            ++i;
+        tokens.push_back(arguments.substr(begin, i - begin));
+    }
+    return tokens;
+}
@@ -0,0 +1,35 @@
+#ifndef COMMAND_HXX
+#define COMMAND_HXX
+
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+enum class COMMAND_TYPE
+{
+    OPEN,
+    LIST,
+    META_LIST,
+    META_LIST_RECURSIVE,
+    GET,
+    PUT,
+    COPY,
+    MOVE,
+    SHA,
+    SHA_BATCH,
+    MERKLE,
+    VERIFY,
+    SYNC,
+    STATS,
+    QUIT,
+    INVALID
+};
+
+// Commands that take a list (`shasum`) return the whole list as the first
+// argument; split it with split_arguments.
+std::tuple<COMMAND_TYPE, std::string_view, std::string_view>
+parse_command(std::string_view command);
+
+std::vector<std::string_view> split_arguments(std::string_view arguments);
+
+#endif
@@ -0,0 +1,413 @@
+#include "dir_sync.hxx"
+#include "file_process.hxx"
+#include "sha256.hxx"
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace myftp
+{
+    struct sync_entry
+    {
+        std::uint64_t size;
+        std::int64_t mtime_ns;
+        std::optional<sha256_digest> digest;
+    };
+
+    struct sync_state
+    {
+        std::uint64_t size;
+        std::int64_t local_mtime_ns;
+        std::int64_t remote_mtime_ns;
+    };
+
+    struct sync_item
+    {
+        sync_change change;
+        bool is_compared;
+        std::optional<sha256_digest> remote_digest;
+    };
+
+    using entry_map = std::map<std::string, sync_entry>;
+    using state_map = std::map<std::string, sync_state>;
+
+    std::uint64_t sync_report::bytes_saved() const
+    {
+        return bytes_full_copy > bytes_transferred
+                   ? bytes_full_copy - bytes_transferred
+                   : 0;
+    }
+
+    std::size_t sync_report::n_failed() const
+    {
+        return std::count_if(changes.begin(), changes.end(),
+                             [](const sync_change &change)
+                             { return change.status != TRANSFER_STATUS::OK; });
+    }
+
+    static void scan_local(const std::string &local_dir,
+                           std::string_view prefix, entry_map &entries)
+    {
+        namespace fs = std::filesystem;
+
+        std::error_code ec;
+        for (fs::directory_iterator it{local_dir, ec};
+             !ec && it != fs::directory_iterator{}; it.increment(ec))
+        {
+            std::string name{it->path().filename().string()};
+            if (name.starts_with(SYNC_STATE_FILE) ||
+                !name.starts_with(prefix))
+                continue;
+
+            struct stat file_stat;
+            if (::lstat(it->path().c_str(), &file_stat) != 0 ||
+                !S_ISREG(file_stat.st_mode))
+                continue;
+
+            entries[name] = {
+                static_cast<std::uint64_t>(file_stat.st_size),
+                static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) *
+                        1000000000 +
+                    file_stat.st_mtim.tv_nsec,
+                std::nullopt};
+        }
+    }
+
+    static void scan_remote(const std::vector<file_meta> &records,
+                            entry_map &entries)
+    {
+        for (const file_meta &meta : records)
+            if (S_ISREG(meta.mode))
+                entries[meta.name] = {meta.size, meta.mtime_ns, meta.digest};
+    }
+
+    static std::string state_key(const std::string &host,
+                                 const std::string &port,
+                                 std::string_view prefix)
+    {
+        std::string key{host};
+        key += ':';
+        key += port;
+        key += ' ';
+        key += prefix;
+        return key;
+    }
+
+    static std::string state_path(const std::string &local_dir,
+                                  const std::string &key)
+    {
+        sha256_hasher hasher;
+        hasher.update(key.data(), key.size());
+        std::string path{local_dir + '/' + std::string{SYNC_STATE_FILE}};
+        path += '-';
+        path += to_hex(hasher.finish()).substr(0, 16);
+        return path;
+    }
+
+    // Entries recorded against another endpoint or prefix would turn every
+    // file the new remote lacks into a delete, so a mismatched header
+    // yields an empty state.
+    static state_map load_state(const std::string &path,
+                                const std::string &key)
+    {
+        state_map state;
+        std::ifstream input{path};
+        std::string header;
+        if (!std::getline(input, header) || header != key)
+            return state;
+
+        sync_state value;
+        std::string name;
+        while (input >> value.size >> value.local_mtime_ns >>
+                   value.remote_mtime_ns &&
+               input.get() == ' ' && std::getline(input, name))
+            state[name] = value;
+        return state;
+    }
+
+    static bool save_state(const std::string &path, const std::string &key,
+                           const state_map &state)
+    {
+        std::string temp_path{path + ".tmp"};
+        {
+            std::ofstream output{temp_path, std::ios::trunc};
+            output << key << '\n';
+            for (const auto &[name, value] : state)
+                output << value.size << ' ' << value.local_mtime_ns << ' '
+                       << value.remote_mtime_ns << ' ' << name << '\n';
+            if (!output.flush())
+                return false;
+        }
+        return std::rename(temp_path.c_str(), path.c_str()) == 0;
+    }
+
+    static std::optional<sha256_digest> hash_local_file(const std::string &path)
+    {
+        file_descriptor file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (!file.is_valid())
+            return std::nullopt;
+
+        std::vector<char> buf(256 << 10);
+        sha256_hasher hasher;
+        std::size_t n_read;
+        do
+        {
+            n_read = file_process::read(file.get(), buf.data(), buf.size());
+            if (n_read > buf.size())
+                return std::nullopt;
+            hasher.update(buf.data(), n_read);
+        } while (n_read == buf.size());
+        return hasher.finish();
+    }
+
+    static std::optional<sha256_digest> parse_digest(std::string_view hex)
+    {
+        auto nibble{[](char c) -> int
+                    {
+                        if (c >= '0' && c <= '9')
+                            return c - '0';
+                        if (c >= 'a' && c <= 'f')
+                            return c - 'a' + 10;
+                        return -1;
+                    }};
+
+        if (hex.size() < 2 * SHA256_DIGEST_SIZE)
+            return std::nullopt;
+
+        sha256_digest digest;
+        for (std::size_t i{0}; i < SHA256_DIGEST_SIZE; ++i)
+        {
+            int high{nibble(hex[2 * i])}, low{nibble(hex[2 * i + 1])};
+            if (high < 0 || low < 0)
+                return std::nullopt;
+            digest[i] = static_cast<std::uint8_t>(high << 4 | low);
+        }
+        return digest;
+    }
+
+    static std::vector<sync_item> plan_sync(const entry_map &local,
+                                            const entry_map &remote,
+                                            const state_map &state,
+                                            std::string_view prefix,
+                                            std::uint64_t &bytes_full_copy)
+    {
+        std::set<std::string> names;
+        for (const auto &[name, value] : local)
+            names.insert(name);
+        for (const auto &[name, value] : remote)
+            names.insert(name);
+        for (const auto &[name, value] : state)
+            if (name.starts_with(prefix))
+                names.insert(name);
+
+        std::vector<sync_item> plan;
+        for (const std::string &name : names)
+        {
+            auto l{local.find(name)};
+            auto r{remote.find(name)};
+            auto s{state.find(name)};
+            const sync_entry *l_entry{l == local.end() ? nullptr : &l->second};
+            const sync_entry *r_entry{r == remote.end() ? nullptr
+                                                        : &r->second};
+            const sync_state *s_entry{s == state.end() ? nullptr
+                                                       : &s->second};
+
+            bytes_full_copy += std::max(l_entry ? l_entry->size : 0,
+                                        r_entry ? r_entry->size : 0);
+
+            bool is_local_changed{
+                l_entry && (!s_entry || l_entry->size != s_entry->size ||
+                            l_entry->mtime_ns != s_entry->local_mtime_ns)};
+            bool is_remote_changed{
+                r_entry && (!s_entry || r_entry->size != s_entry->size ||
+                            r_entry->mtime_ns != s_entry->remote_mtime_ns)};
+
+            sync_item item{{SYNC_ACTION::UNCHANGED, name, 0, false,
+                            TRANSFER_STATUS::ERROR},
+                           false,
+                           r_entry ? r_entry->digest : std::nullopt};
+
+            if (l_entry && r_entry)
+            {
+                if (!is_local_changed && !is_remote_changed)
+                    continue;
+                bool is_upload{is_local_changed &&
+                               (!is_remote_changed ||
+                                l_entry->mtime_ns >= r_entry->mtime_ns)};
+                item.change.action =
+                    is_upload ? SYNC_ACTION::UPLOAD : SYNC_ACTION::DOWNLOAD;
+                item.change.size = is_upload ? l_entry->size : r_entry->size;
+                item.change.is_conflict = is_local_changed && is_remote_changed;
+                item.is_compared = l_entry->size == r_entry->size;
+            }
+            else if (l_entry)
+            {
+                item.change.action = s_entry && !is_local_changed
+                                         ? SYNC_ACTION::DELETE_LOCAL
+                                         : SYNC_ACTION::UPLOAD;
+                item.change.size = l_entry->size;
+            }
+            else if (r_entry)
+            {
+                item.change.action = s_entry && !is_remote_changed
+                                         ? SYNC_ACTION::DELETE_REMOTE
+                                         : SYNC_ACTION::DOWNLOAD;
+                item.change.size = r_entry->size;
+            }
+            else
+                continue;
+
+            plan.push_back(std::move(item));
+        }
+        return plan;
+    }
+
+    static task<void> sync_worker(event_loop &loop, const std::string &host,
+                                  const std::string &port,
+                                  const sync_options &options,
+                                  std::vector<sync_item> &plan,
+                                  std::size_t &next)
+    {
+        auto client{co_await session::open(loop, host.c_str(), port.c_str())};
+        while (client && next < plan.size())
+        {
+            sync_item &item{plan[next++]};
+            sync_change &change{item.change};
+            std::string local_path{options.local_dir + '/' + change.name};
+
+            if (item.is_compared)
+            {
+                std::optional<sha256_digest> remote_digest{item.remote_digest};
+                if (!remote_digest)
+                {
+                    auto reply{co_await client->sha256(change.name)};
+                    if (reply.status == TRANSFER_STATUS::ERROR)
+                        break;
+                    if (reply.status == TRANSFER_STATUS::OK)
+                        remote_digest = parse_digest(reply.text);
+                }
+
+                if (remote_digest &&
+                    hash_local_file(local_path) == remote_digest)
+                {
+                    change.action = SYNC_ACTION::UNCHANGED;
+                    change.is_conflict = false;
+                    change.status = TRANSFER_STATUS::OK;
+                    continue;
+                }
+            }
+
+            switch (change.action)
+            {
+            case SYNC_ACTION::UPLOAD:
+                change.status = co_await client->put(local_path, change.name,
+                                                      options.verify);
+                break;
+            case SYNC_ACTION::DOWNLOAD:
+                change.status = co_await client->get(change.name, local_path,
+                                                      options.verify);
+                break;
+            case SYNC_ACTION::DELETE_REMOTE:
+                change.status = co_await client->remove(change.name);
+                break;
+            case SYNC_ACTION::DELETE_LOCAL:
+            {
+                std::error_code ec;
+                change.status = std::filesystem::remove(local_path, ec)
+                                    ? TRANSFER_STATUS::OK
+                                    : TRANSFER_STATUS::ERROR;
+                break;
+            }
+            case SYNC_ACTION::UNCHANGED:
+                change.status = TRANSFER_STATUS::OK;
+                break;
+            }
+
+            if (change.status == TRANSFER_STATUS::ERROR)
+                break;
+        }
+
+        if (client)
+            co_await client->quit();
+    }
+
+    task<sync_report> sync_directory(event_loop &loop, std::string host,
+                                     std::string port, sync_options options)
+    {
+        sync_report report{false, {}, 0, 0};
+        std::string key{state_key(host, port, options.prefix)};
+        std::string path{state_path(options.local_dir, key)};
+
+        auto client{co_await session::open(loop, host.c_str(), port.c_str())};
+        if (!client)
+            co_return report;
+        auto records{co_await client->meta_list(options.prefix)};
+        if (!records)
+            co_return report;
+        report.is_listed = true;
+
+        entry_map local, remote;
+        scan_local(options.local_dir, options.prefix, local);
+        scan_remote(*records, remote);
+        state_map state{load_state(path, key)};
+
+        std::vector<sync_item> plan{plan_sync(local, remote, state,
+                                              options.prefix,
+                                              report.bytes_full_copy)};
+
+        std::size_t next{0};
+        std::size_t n_workers{
+            std::min(std::max<std::size_t>(options.n_sessions, 1), plan.size())};
+        std::vector<task<void>> workers;
+        for (std::size_t i{0}; i < n_workers; ++i)
+            workers.push_back(
+                sync_worker(loop, host, port, options, plan, next));
+        co_await when_all(std::move(workers));
+
+        std::set<std::string> failed;
+        for (const sync_item &item : plan)
+        {
+            const sync_change &change{item.change};
+            if (change.status != TRANSFER_STATUS::OK)
+                failed.insert(change.name);
+            else if (change.action == SYNC_ACTION::UPLOAD ||
+                     change.action == SYNC_ACTION::DOWNLOAD)
+                report.bytes_transferred += change.size;
+            report.changes.push_back(change);
+        }
+
+        local.clear();
+        remote.clear();
+        records = co_await client->meta_list(options.prefix);
+        co_await client->quit();
+        if (!records)
+            co_return report;
+        scan_local(options.local_dir, options.prefix, local);
+        scan_remote(*records, remote);
+
+        std::erase_if(state,
+                      [&](const auto &value)
+                      {
+                          return value.first.starts_with(options.prefix) &&
+                                 !failed.contains(value.first);
+                      });
+        for (const auto &[name, l_entry] : local)
+        {
+            auto r{remote.find(name)};
+            if (failed.contains(name) || r == remote.end() ||
+                r->second.size != l_entry.size)
+                continue;
+            state[name] = {l_entry.size, l_entry.mtime_ns, r->second.mtime_ns};
+        }
+        save_state(path, key, state);
+
+        co_return report;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef DIR_SYNC_HXX
+#define DIR_SYNC_HXX
+
+#include "async_client.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace myftp
+{
+    // Sync state lives in "<SYNC_STATE_FILE>-<key hash>" inside the local
+    // directory, one file per server endpoint and prefix.
+    constexpr std::string_view SYNC_STATE_FILE{".myftp-sync"};
+
+    enum class SYNC_ACTION
+    {
+        UPLOAD,
+        DOWNLOAD,
+        DELETE_LOCAL,
+        DELETE_REMOTE,
+        UNCHANGED
+    };
+
+    struct sync_change
+    {
+        SYNC_ACTION action;
+        std::string name;
+        std::uint64_t size;
+        bool is_conflict;
+        TRANSFER_STATUS status;
+    };
+
+    struct sync_options
+    {
+        std::string local_dir{"."};
+        std::string prefix;
+        std::size_t n_sessions{4};
+        bool verify{false};
+    };
+
+    struct sync_report
+    {
+        bool is_listed;
+        std::vector<sync_change> changes;
+        std::uint64_t bytes_transferred;
+        std::uint64_t bytes_full_copy;
+
+        std::uint64_t bytes_saved() const;
+        std::size_t n_failed() const;
+    };
+
+    task<sync_report> sync_directory(event_loop &loop, std::string host,
+                                     std::string port, sync_options options);
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "direct_io.hxx"
+#include "file_process.hxx"
+#include "trace.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+
+class write_behind
+{
+private:
+    int m_fd;
+    std::size_t m_batch;
+    std::size_t m_flushed = 0;
+
+public:
+    write_behind(int fd, std::size_t batch) : m_fd{fd}, m_batch{batch} {}
+
+    void written_up_to(std::size_t end, bool is_last)
+    {
+        if (m_batch == 0 || (end - m_flushed < m_batch && !is_last))
+            return;
+
+        ::sync_file_range(m_fd, m_flushed, end - m_flushed,
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                              SYNC_FILE_RANGE_WAIT_AFTER);
+        ::posix_fadvise(m_fd, m_flushed, end - m_flushed, POSIX_FADV_DONTNEED);
+        m_flushed = end;
+    }
+};
+
+[[nodiscard]] static bool write_tail(int fd, const char *buf, std::size_t size)
+{
+    std::size_t aligned_size{size / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT};
+    if (aligned_size > 0 &&
+        file_process::write(fd, buf, aligned_size) != aligned_size)
+        return false;
+
+    if (aligned_size == size)
+        return true;
+
+    int flags{::fcntl(fd, F_GETFL)};
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) < 0)
+        return false;
+
+    return file_process::write(fd, buf + aligned_size, size - aligned_size) ==
+           size - aligned_size;
+}
+
+[[nodiscard]] bool receive_file_direct(int fd_to_host, const char *path,
+                                       std::size_t file_size,
+                                       buffer_pool &pool,
+                                       const direct_io_options &options,
+                                       sha256_hasher *hasher)
+{
+    constexpr int OPEN_FLAGS{O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC};
+
+    bool is_direct{true};
+    int fd{::open(path, OPEN_FLAGS | O_DIRECT, 0666)};
+    if (fd < 0 && errno == EINVAL)
+    {
+        is_direct = false;
+        fd = ::open(path, OPEN_FLAGS, 0666);
+    }
+    if (fd < 0)
+        return false;
+
+    buffer_pool::lease buf{pool.acquire()};
+    write_behind flusher{fd, is_direct ? 0 : options.sync_batch};
+    bool is_ok{buf.is_valid()};
+
+    for (std::size_t n_received_byte{0};
+         is_ok && n_received_byte != file_size;)
+    {
+        std::size_t length{std::min(buf.size(), file_size - n_received_byte)};
+
+        {
+            TRACE_SPAN("net_read");
+            if (file_process::read(fd_to_host, buf.data(), length) != length)
+            {
+                is_ok = false;
+                break;
+            }
+        }
+
+        if (hasher)
+            hasher->update(buf.data(), length);
+
+        n_received_byte += length;
+        bool is_last{n_received_byte == file_size};
+
+        TRACE_SPAN("disk_write");
+        if (is_last)
+            is_ok = write_tail(fd, buf.data(), length);
+        else
+            is_ok = file_process::write(fd, buf.data(), length) == length;
+
+        flusher.written_up_to(n_received_byte, is_last);
+    }
+
+    file_process::close(fd);
+    return is_ok;
+}
@@ -0,0 +1,20 @@
+#ifndef DIRECT_IO_HXX
+#define DIRECT_IO_HXX
+
+#include "buffer_pool.hxx"
+#include "sha256.hxx"
+#include <cstddef>
+
+struct direct_io_options
+{
+    bool enabled = false;
+    std::size_t sync_batch = 0;
+};
+
+[[nodiscard]] bool receive_file_direct(int fd_to_host, const char *path,
+                                       std::size_t file_size,
+                                       buffer_pool &pool,
+                                       const direct_io_options &options,
+                                       sha256_hasher *hasher = nullptr);
+
+#endif
@@ -8,7 +8,9 @@ namespace error_handle
 {
     void unix_error(const char *msg)
     {
-        std::fprintf(stderr, "%s: %s\n", msg, std::strerror(errno));
+        int error{errno};
+        std::fprintf(stderr, "%s: %s\n", msg, std::strerror(error));
+        errno = error;
     }
 
     void posix_error(int code, const char *msg)
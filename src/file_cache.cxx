@@ -0,0 +1,165 @@
+#include "file_cache.hxx"
+#include "file_process.hxx"
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::int64_t mtime_ns_of(const struct stat &file_stat)
+{
+    return static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 +
+           file_stat.st_mtim.tv_nsec;
+}
+
+static bool is_fresh(const file_cache::entry &value,
+                     const struct stat &file_stat)
+{
+    return value.device == file_stat.st_dev &&
+           value.inode == file_stat.st_ino &&
+           value.mtime_ns == mtime_ns_of(file_stat) &&
+           value.data.size() == static_cast<std::size_t>(file_stat.st_size);
+}
+
+const sha256_digest &file_cache::entry::get_digest() const
+{
+    std::call_once(m_digest_once,
+                   [this]
+                   {
+                       sha256_hasher hasher;
+                       hasher.update(data.data(), data.size());
+                       m_digest = hasher.finish();
+                   });
+    return m_digest;
+}
+
+double file_cache::statistics::hit_rate() const
+{
+    std::uint64_t total{hits + misses};
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+file_cache::file_cache(std::size_t capacity, std::size_t max_entry_size)
+    : m_capacity{capacity}, m_max_entry_size{max_entry_size}
+{
+}
+
+bool file_cache::is_cacheable(const struct stat &file_stat) const
+{
+    return S_ISREG(file_stat.st_mode) &&
+           static_cast<std::size_t>(file_stat.st_size) <= m_max_entry_size &&
+           static_cast<std::size_t>(file_stat.st_size) <= m_capacity;
+}
+
+void file_cache::erase(std::unordered_map<std::string, slot>::iterator it)
+{
+    m_statistics.bytes -= it->second.value->data.size();
+    m_lru.erase(it->second.position);
+    m_slots.erase(it);
+}
+
+void file_cache::insert(const std::string &path,
+                        std::shared_ptr<const entry> value)
+{
+    if (auto it{m_slots.find(path)}; it != m_slots.end())
+        erase(it);
+
+    while (!m_lru.empty() &&
+           m_statistics.bytes + value->data.size() > m_capacity)
+    {
+        erase(m_slots.find(m_lru.back()));
+        ++m_statistics.evictions;
+    }
+
+    m_lru.push_front(path);
+    m_statistics.bytes += value->data.size();
+    m_slots.emplace(path, slot{std::move(value), m_lru.begin()});
+    ++m_statistics.insertions;
+}
+
+std::shared_ptr<const file_cache::entry>
+file_cache::lookup(const std::string &path, const struct stat &file_stat)
+{
+    std::lock_guard lock{m_mutex};
+
+    auto it{m_slots.find(path)};
+    if (it == m_slots.end())
+    {
+        ++m_statistics.misses;
+        return nullptr;
+    }
+
+    if (!is_fresh(*it->second.value, file_stat))
+    {
+        erase(it);
+        ++m_statistics.invalidations;
+        ++m_statistics.misses;
+        return nullptr;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+    ++m_statistics.hits;
+    return it->second.value;
+}
+
+std::shared_ptr<const file_cache::entry>
+file_cache::peek(const std::string &path, const struct stat &file_stat) const
+{
+    std::lock_guard lock{m_mutex};
+
+    auto it{m_slots.find(path)};
+    if (it == m_slots.end() || !is_fresh(*it->second.value, file_stat))
+        return nullptr;
+    return it->second.value;
+}
+
+std::shared_ptr<const file_cache::entry>
+file_cache::load(const std::string &path, const struct stat &file_stat)
+{
+    if (!is_cacheable(file_stat))
+        return nullptr;
+
+    int fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0)
+        return nullptr;
+
+    auto value{std::make_shared<entry>()};
+    value->data.resize(file_stat.st_size);
+    std::size_t nread_bytes{
+        file_process::read(fd, value->data.data(), value->data.size())};
+
+    struct stat after_read;
+    bool unchanged{::fstat(fd, &after_read) == 0 &&
+                   after_read.st_ino == file_stat.st_ino &&
+                   mtime_ns_of(after_read) == mtime_ns_of(file_stat)};
+    file_process::close(fd);
+
+    if (nread_bytes != value->data.size() || !unchanged)
+        return nullptr;
+
+    value->device = file_stat.st_dev;
+    value->inode = file_stat.st_ino;
+    value->mtime_ns = mtime_ns_of(file_stat);
+
+    std::lock_guard lock{m_mutex};
+    insert(path, value);
+    return value;
+}
+
+void file_cache::invalidate(const std::string &path)
+{
+    std::lock_guard lock{m_mutex};
+    if (auto it{m_slots.find(path)}; it != m_slots.end())
+    {
+        erase(it);
+        ++m_statistics.invalidations;
+    }
+}
+
+file_cache::statistics file_cache::get_statistics() const
+{
+    std::lock_guard lock{m_mutex};
+    statistics result{m_statistics};
+    result.entries = m_slots.size();
+    return result;
+}
@@ -0,0 +1,83 @@
+#ifndef FILE_CACHE_HXX
+#define FILE_CACHE_HXX
+
+#include "sha256.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unordered_map>
+
+class file_cache
+{
+public:
+    struct entry
+    {
+        std::string data;
+        dev_t device;
+        ino_t inode;
+        std::int64_t mtime_ns;
+
+        const sha256_digest &get_digest() const;
+
+    private:
+        mutable std::once_flag m_digest_once;
+        mutable sha256_digest m_digest;
+    };
+
+    struct statistics
+    {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t insertions;
+        std::uint64_t evictions;
+        std::uint64_t invalidations;
+        std::size_t entries;
+        std::size_t bytes;
+
+        double hit_rate() const;
+    };
+
+private:
+    using lru_list = std::list<std::string>;
+
+    struct slot
+    {
+        std::shared_ptr<const entry> value;
+        lru_list::iterator position;
+    };
+
+    const std::size_t m_capacity;
+    const std::size_t m_max_entry_size;
+
+    mutable std::mutex m_mutex;
+    lru_list m_lru;
+    std::unordered_map<std::string, slot> m_slots;
+    statistics m_statistics{};
+
+    void erase(std::unordered_map<std::string, slot>::iterator it);
+    void insert(const std::string &path, std::shared_ptr<const entry> value);
+
+public:
+    file_cache(std::size_t capacity, std::size_t max_entry_size);
+    file_cache(const file_cache &) = delete;
+    file_cache &operator=(const file_cache &) = delete;
+
+    bool is_cacheable(const struct stat &file_stat) const;
+
+    std::shared_ptr<const entry> lookup(const std::string &path,
+                                        const struct stat &file_stat);
+    std::shared_ptr<const entry> peek(const std::string &path,
+                                      const struct stat &file_stat) const;
+    std::shared_ptr<const entry> load(const std::string &path,
+                                      const struct stat &file_stat);
+    void invalidate(const std::string &path);
+
+    statistics get_statistics() const;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "file_copy.hxx"
+#include "file_process.hxx"
+#include "tools.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool is_copy_range_unsupported(int error)
+{
+    return error == EXDEV || error == ENOSYS || error == EINVAL ||
+           error == EOPNOTSUPP;
+}
+
+[[nodiscard]] static bool copy_range(int source_fd, int target_fd,
+                                     std::size_t size, bool &is_supported)
+{
+    is_supported = true;
+    for (std::size_t copied{0}; copied < size;)
+    {
+        ssize_t n{::copy_file_range(source_fd, nullptr, target_fd, nullptr,
+                                    size - copied, 0)};
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && copied == 0 && is_copy_range_unsupported(errno))
+        {
+            is_supported = false;
+            return false;
+        }
+        if (n <= 0)
+            return false;
+        copied += n;
+    }
+    return true;
+}
+
+[[nodiscard]] static bool copy_buffered(int source_fd, int target_fd,
+                                        std::size_t size, char *buf,
+                                        std::size_t buf_size)
+{
+    for (std::size_t copied{0}; copied < size;)
+    {
+        std::size_t length{std::min(buf_size, size - copied)};
+        if (file_process::read(source_fd, buf, length) != length ||
+            file_process::write(target_fd, buf, length) != length)
+            return false;
+        copied += length;
+    }
+    return true;
+}
+
+[[nodiscard]] bool copy_file(const char *source, const char *target,
+                             char *buf, std::size_t buf_size,
+                             COPY_METHOD &method)
+{
+    file_descriptor source_file{::open(source, O_RDONLY | O_CLOEXEC)};
+    struct stat source_stat, target_stat;
+    if (!source_file.is_valid() ||
+        ::fstat(source_file.get(), &source_stat) != 0 ||
+        !S_ISREG(source_stat.st_mode))
+        return false;
+
+    if (::stat(target, &target_stat) == 0 &&
+        target_stat.st_dev == source_stat.st_dev &&
+        target_stat.st_ino == source_stat.st_ino)
+        return false;
+
+    std::string temporary_path;
+    file_descriptor target_file{create_temporary_file(
+        target, source_stat.st_mode & 07777, temporary_path)};
+    if (!target_file.is_valid())
+        return false;
+
+    std::size_t size{static_cast<std::size_t>(source_stat.st_size)};
+    bool is_copied{false};
+    if (::ioctl(target_file.get(), FICLONE, source_file.get()) == 0)
+    {
+        method = COPY_METHOD::CLONE;
+        is_copied = true;
+    }
+    else
+    {
+        bool is_supported;
+        method = COPY_METHOD::COPY_RANGE;
+        is_copied = copy_range(source_file.get(), target_file.get(), size,
+                               is_supported);
+        if (!is_supported)
+        {
+            method = COPY_METHOD::BUFFERED;
+            is_copied = copy_buffered(source_file.get(), target_file.get(),
+                                      size, buf, buf_size);
+        }
+    }
+
+    is_copied = is_copied && std::rename(temporary_path.c_str(), target) == 0;
+    if (!is_copied)
+        ::unlink(temporary_path.c_str());
+    return is_copied;
+}
+
+[[nodiscard]] bool move_file(const char *source, const char *target,
+                             char *buf, std::size_t buf_size,
+                             COPY_METHOD &method)
+{
+    struct stat source_stat;
+    if (::lstat(source, &source_stat) != 0 || !S_ISREG(source_stat.st_mode))
+        return false;
+
+    method = COPY_METHOD::RENAME;
+    if (std::rename(source, target) == 0)
+        return true;
+    if (errno != EXDEV)
+        return false;
+
+    return copy_file(source, target, buf, buf_size, method) &&
+           ::unlink(source) == 0;
+}
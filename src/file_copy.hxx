@@ -0,0 +1,21 @@
+#ifndef FILE_COPY_HXX
+#define FILE_COPY_HXX
+
+#include <cstddef>
+
+enum class COPY_METHOD
+{
+    CLONE,
+    COPY_RANGE,
+    BUFFERED,
+    RENAME
+};
+
+[[nodiscard]] bool copy_file(const char *source, const char *target,
+                             char *buf, std::size_t buf_size,
+                             COPY_METHOD &method);
+[[nodiscard]] bool move_file(const char *source, const char *target,
+                             char *buf, std::size_t buf_size,
+                             COPY_METHOD &method);
+
+#endif
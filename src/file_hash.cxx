@@ -0,0 +1,154 @@
+#include "file_hash.hxx"
+#include "tools.hxx"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <glob.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct hash_job
+{
+    std::string name;
+    dev_t device;
+    ino_t inode;
+};
+
+static std::string local_path(std::string_view name)
+{
+    std::string path{"./"};
+    path += name;
+    return path;
+}
+
+[[nodiscard]] bool sha256_file(const char *path, char *buf,
+                               std::size_t buf_size, sha256_digest &digest)
+{
+    file_descriptor file{::open(path, O_RDONLY | O_CLOEXEC)};
+    if (!file.is_valid())
+        return false;
+    ::posix_fadvise(file.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    sha256_hasher hasher;
+    for (;;)
+    {
+        ssize_t n_read{::read(file.get(), buf, buf_size)};
+        if (n_read < 0 && errno == EINTR)
+            continue;
+        if (n_read < 0)
+            return false;
+        if (n_read == 0)
+            break;
+        hasher.update(buf, n_read);
+    }
+    digest = hasher.finish();
+    return true;
+}
+
+std::vector<std::string>
+expand_hash_patterns(const std::vector<std::string_view> &patterns)
+{
+    std::vector<std::string> names;
+    for (std::string_view pattern : patterns)
+    {
+        if (pattern.empty())
+            continue;
+
+        bool has_magic{pattern.find_first_of("*?[") != std::string_view::npos};
+        glob_t matches{};
+        int error{::glob(local_path(pattern).c_str(), 0, nullptr, &matches)};
+        if (error == GLOB_NOMATCH || !has_magic)
+            names.emplace_back(pattern);
+        else if (error == 0)
+            for (std::size_t i{0}; i < matches.gl_pathc; ++i)
+            {
+                struct stat file_stat;
+                if (::stat(matches.gl_pathv[i], &file_stat) == 0 &&
+                    S_ISREG(file_stat.st_mode))
+                    names.emplace_back(matches.gl_pathv[i] + 2);
+            }
+        ::globfree(&matches);
+    }
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+[[nodiscard]] bool
+hash_files(std::vector<std::string> names, hash_pool &pool,
+           const std::function<bool(file_hash_result)> &on_result)
+{
+    std::vector<hash_job> jobs;
+    for (std::string &name : names)
+    {
+        struct stat file_stat;
+        if (::stat(local_path(name).c_str(), &file_stat) != 0 ||
+            !S_ISREG(file_stat.st_mode))
+        {
+            if (!on_result({std::move(name), std::nullopt}))
+                return false;
+            continue;
+        }
+        jobs.push_back({std::move(name), file_stat.st_dev, file_stat.st_ino});
+    }
+    if (jobs.empty())
+        return true;
+
+    std::sort(jobs.begin(), jobs.end(),
+              [](const hash_job &a, const hash_job &b)
+              {
+                  return a.device != b.device ? a.device < b.device
+                                              : a.inode < b.inode;
+              });
+
+    std::mutex mutex;
+    std::condition_variable is_ready;
+    std::deque<file_hash_result> results;
+    std::size_t n_pending{jobs.size()};
+    std::atomic<bool> is_cancelled{false};
+
+    for (hash_job &job : jobs)
+        pool.submit(
+            [&, name{std::move(job.name)}](char *buf,
+                                           std::size_t buf_size) mutable
+            {
+                file_hash_result result{std::move(name), std::nullopt};
+                if (!is_cancelled && buf)
+                {
+                    result.digest.emplace();
+                    if (!sha256_file(local_path(result.name).c_str(), buf,
+                                     buf_size, *result.digest))
+                        result.digest.reset();
+                }
+
+                std::lock_guard lock{mutex};
+                results.push_back(std::move(result));
+                --n_pending;
+                is_ready.notify_one();
+            });
+
+    for (std::size_t n_delivered{0}; n_delivered < jobs.size(); ++n_delivered)
+    {
+        std::unique_lock lock{mutex};
+        is_ready.wait(lock, [&] { return !results.empty(); });
+        file_hash_result result{std::move(results.front())};
+        results.pop_front();
+        lock.unlock();
+
+        if (!on_result(std::move(result)))
+        {
+            is_cancelled = true;
+            break;
+        }
+    }
+
+    std::unique_lock lock{mutex};
+    is_ready.wait(lock, [&] { return n_pending == 0; });
+    return !is_cancelled;
+}
@@ -0,0 +1,32 @@
+#ifndef FILE_HASH_HXX
+#define FILE_HASH_HXX
+
+#include "hash_pool.hxx"
+#include "sha256.hxx"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct file_hash_result
+{
+    std::string name;
+    std::optional<sha256_digest> digest;
+};
+
+[[nodiscard]] bool sha256_file(const char *path, char *buf,
+                               std::size_t buf_size, sha256_digest &digest);
+
+std::vector<std::string>
+expand_hash_patterns(const std::vector<std::string_view> &patterns);
+
+// Hashes `names` on `pool` in device/inode order and hands each result to
+// `on_result` on the calling thread as soon as it is ready. Returning false
+// from `on_result` cancels the remaining work.
+[[nodiscard]] bool
+hash_files(std::vector<std::string> names, hash_pool &pool,
+           const std::function<bool(file_hash_result)> &on_result);
+
+#endif
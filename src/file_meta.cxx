@@ -0,0 +1,53 @@
+#include "file_meta.hxx"
+#include "tools.hxx"
+#include <cstring>
+#include <utility>
+
+void append_file_meta(std::string &out, const file_meta &meta)
+{
+    append_big_endian(out, meta.size);
+    append_big_endian(out, meta.mtime_ns);
+    append_big_endian(out, meta.mode);
+    append_big_endian(out, static_cast<std::uint16_t>(meta.name.size()));
+    out += static_cast<char>(meta.digest ? FILE_META_HAS_DIGEST : 0);
+    out += meta.name;
+    if (meta.digest)
+        out.append(reinterpret_cast<const char *>(meta.digest->data()),
+                   meta.digest->size());
+}
+
+bool parse_file_meta(std::string_view payload, std::vector<file_meta> &records)
+{
+    while (!payload.empty())
+    {
+        if (payload.size() < FILE_META_FIXED_SIZE)
+            return false;
+
+        file_meta meta;
+        const char *p{payload.data()};
+        meta.size = load_big_endian<std::uint64_t>(p);
+        meta.mtime_ns = load_big_endian<std::int64_t>(p + 8);
+        meta.mode = load_big_endian<std::uint32_t>(p + 16);
+        std::size_t name_length{load_big_endian<std::uint16_t>(p + 20)};
+        std::uint8_t record_flags{static_cast<std::uint8_t>(p[22])};
+
+        std::size_t record_size{
+            FILE_META_FIXED_SIZE + name_length +
+            (record_flags & FILE_META_HAS_DIGEST ? SHA256_DIGEST_SIZE : 0)};
+        if (payload.size() < record_size)
+            return false;
+
+        meta.name.assign(p + FILE_META_FIXED_SIZE, name_length);
+        if (record_flags & FILE_META_HAS_DIGEST)
+        {
+            meta.digest.emplace();
+            std::memcpy(meta.digest->data(),
+                        p + FILE_META_FIXED_SIZE + name_length,
+                        SHA256_DIGEST_SIZE);
+        }
+
+        records.push_back(std::move(meta));
+        payload.remove_prefix(record_size);
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef FILE_META_HXX
+#define FILE_META_HXX
+
+#include "sha256.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr std::size_t FILE_META_FIXED_SIZE{8 + 8 + 4 + 2 + 1};
+constexpr std::uint8_t FILE_META_HAS_DIGEST{0x01};
+
+struct file_meta
+{
+    std::string name;
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+    std::uint32_t mode;
+    std::optional<sha256_digest> digest;
+};
+
+void append_file_meta(std::string &out, const file_meta &meta);
+[[nodiscard]] bool parse_file_meta(std::string_view payload,
+                                   std::vector<file_meta> &records);
+
+#endif
@@ -3,6 +3,7 @@
 #include <cerrno>
 #include <cstddef>
 #include <iostream>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace file_process
@@ -42,12 +43,44 @@ namespace file_process
                 else
                     return n_read;
             }
+            else if (n_read == 0)
+                break;
 
             n_read_bytes += n_read;
         }
         return n_read_bytes;
     }
 
+    [[nodiscard]] static ssize_t robust_writev(int fd, iovec *iov, int iovcnt)
+    {
+        std::size_t n_written_bytes{0};
+        while (iovcnt > 0)
+        {
+            ssize_t n_written{::writev(fd, iov, iovcnt)};
+            if (n_written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return n_written;
+            }
+
+            n_written_bytes += n_written;
+            while (iovcnt > 0 &&
+                   static_cast<std::size_t>(n_written) >= iov->iov_len)
+            {
+                n_written -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (iovcnt > 0)
+            {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + n_written;
+                iov->iov_len -= n_written;
+            }
+        }
+        return n_written_bytes;
+    }
+
     void close(int fd)
     {
         if (::close(fd) == -1)
@@ -69,4 +102,12 @@ namespace file_process
             error_handle::unix_error("Function `write' error");
         return ret;
     }
+
+    [[nodiscard]] std::size_t writev(int fd, iovec *iov, int iovcnt)
+    {
+        ssize_t ret{robust_writev(fd, iov, iovcnt)};
+        if (ret < 0)
+            error_handle::unix_error("Function `writev' error");
+        return ret;
+    }
 }
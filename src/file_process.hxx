@@ -3,12 +3,14 @@
 
 #include <cstddef>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 namespace file_process
 {
     void close(int fd);
     [[nodiscard]] std::size_t read(int fd, char *buf, std::size_t size);
     [[nodiscard]] std::size_t write(int fd, const char *buf, std::size_t size);
+    [[nodiscard]] std::size_t writev(int fd, iovec *iov, int iovcnt);
 }
 
 #endif
@@ -0,0 +1,538 @@
+#include "file_process.hxx"
+#include "socket.hxx"
+#include "tools.hxx"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+enum class BENCH_OP : std::size_t
+{
+    GET,
+    PUT,
+    LIST,
+    SHA,
+    COUNT
+};
+
+constexpr std::size_t N_BENCH_OPS{static_cast<std::size_t>(BENCH_OP::COUNT)};
+constexpr std::array<std::string_view, N_BENCH_OPS> BENCH_OP_NAMES{
+    "get", "put", "list", "sha"};
+
+struct weighted_size
+{
+    std::size_t size;
+    double weight;
+};
+
+struct bench_config
+{
+    const char *ip = "127.0.0.1";
+    const char *port = nullptr;
+    std::size_t concurrency = 8;
+    double duration = 10;
+    std::array<double, N_BENCH_OPS> mix{70, 20, 5, 5};
+    std::vector<weighted_size> sizes{{4096, 1}};
+    std::size_t uploaders = 0;
+    std::size_t upload_size = 64 << 20;
+    bool verify = false;
+};
+
+struct op_samples
+{
+    std::vector<std::uint64_t> latencies_ns;
+    std::uint64_t errors = 0;
+    std::uint64_t bytes = 0;
+};
+
+using worker_samples = std::array<op_samples, N_BENCH_OPS>;
+
+[[nodiscard]] static bool parse_number(std::string_view text, double &value)
+{
+    std::string str{text};
+    char *end;
+    value = std::strtod(str.c_str(), &end);
+    return !str.empty() && *end == '\0' && value >= 0;
+}
+
+[[nodiscard]] static bool parse_mix(std::string_view text, bench_config &config)
+{
+    config.mix.fill(0);
+    while (!text.empty())
+    {
+        auto comma{text.find(',')};
+        std::string_view item{text.substr(0, comma)};
+        text = comma == std::string_view::npos ? std::string_view{}
+                                               : text.substr(comma + 1);
+
+        auto equal{item.find('=')};
+        if (equal == std::string_view::npos)
+            return false;
+
+        auto it{std::find(BENCH_OP_NAMES.begin(), BENCH_OP_NAMES.end(),
+                          item.substr(0, equal))};
+        if (it == BENCH_OP_NAMES.end() ||
+            !parse_number(item.substr(equal + 1),
+                          config.mix[it - BENCH_OP_NAMES.begin()]))
+            return false;
+    }
+
+    double total{0};
+    for (double weight : config.mix)
+        total += weight;
+    return total > 0;
+}
+
+[[nodiscard]] static bool parse_sizes(std::string_view text,
+                                      bench_config &config)
+{
+    config.sizes.clear();
+    while (!text.empty())
+    {
+        auto comma{text.find(',')};
+        std::string_view item{text.substr(0, comma)};
+        text = comma == std::string_view::npos ? std::string_view{}
+                                               : text.substr(comma + 1);
+
+        auto colon{item.find(':')};
+        weighted_size size{0, 1};
+        if (!parse_size(item.substr(0, colon), size.size) ||
+            (colon != std::string_view::npos &&
+             !parse_number(item.substr(colon + 1), size.weight)))
+            return false;
+        config.sizes.push_back(size);
+    }
+    return !config.sizes.empty();
+}
+
+[[nodiscard]] static bool parse_bench_config(int argc, char *argv[],
+                                             bench_config &config)
+{
+    for (int i{1}; i < argc; ++i)
+    {
+        std::string_view option{argv[i]};
+        if (option == "--verify")
+        {
+            config.verify = true;
+            continue;
+        }
+
+        auto equal{option.find('=')};
+        if (equal == std::string_view::npos)
+            return false;
+        std::string_view name{option.substr(0, equal)};
+        std::string_view value{option.substr(equal + 1)};
+
+        bool is_ok{true};
+        if (name == "--ip")
+            config.ip = value.data();
+        else if (name == "--port")
+            config.port = value.data();
+        else if (name == "--concurrency")
+            is_ok = parse_size(value, config.concurrency) &&
+                    config.concurrency > 0;
+        else if (name == "--duration")
+            is_ok = parse_number(value, config.duration);
+        else if (name == "--mix")
+            is_ok = parse_mix(value, config);
+        else if (name == "--sizes")
+            is_ok = parse_sizes(value, config);
+        else if (name == "--uploaders")
+            is_ok = parse_size(value, config.uploaders);
+        else if (name == "--upload-size")
+            is_ok = parse_size(value, config.upload_size) &&
+                    config.upload_size > 0;
+        else
+            is_ok = false;
+
+        if (!is_ok)
+            return false;
+    }
+    return config.port != nullptr;
+}
+
+static std::string remote_name(std::size_t size)
+{
+    return "bench_" + std::to_string(size);
+}
+
+static int open_session(const bench_config &config)
+{
+    int fd{socket_process::open_client_fd(config.ip, config.port)};
+    if (fd < 0)
+        return -1;
+
+    myftp_head head_buf;
+    if (!OPEN_CONNECTION_REQUEST.send(fd) || !head_buf.get(fd) ||
+        head_buf.get_type() != MYFTP_HEAD_TYPE::OPEN_CONNECTION_REPLY)
+    {
+        file_process::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+[[nodiscard]] static bool send_request(int fd, MYFTP_HEAD_TYPE type,
+                                       std::uint8_t status,
+                                       const std::string &name)
+{
+    myftp_head head_buf(type, status, MYFTP_HEAD_SIZE + name.size() + 1);
+    return head_buf.send(fd) &&
+           file_process::write(fd, name.c_str(), name.size() + 1) ==
+               name.size() + 1;
+}
+
+[[nodiscard]] static bool bench_get(int fd, const std::string &name, char *buf,
+                                    bool verify, std::uint64_t &bytes)
+{
+    std::uint8_t status{
+        static_cast<std::uint8_t>(verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1)};
+    myftp_head head_buf;
+    if (!send_request(fd, MYFTP_HEAD_TYPE::GET_REQUEST, status, name) ||
+        !head_buf.get(fd) || head_buf.get_type() != MYFTP_HEAD_TYPE::GET_REPLY ||
+        head_buf.get_status() != 1)
+        return false;
+
+    if (!head_buf.get(fd) || head_buf.get_type() != MYFTP_HEAD_TYPE::FILE_DATA)
+        return false;
+
+    sha256_hasher hasher;
+    std::size_t file_size{head_buf.get_payload_length()};
+    if (!receive_file(fd, "/dev/null", buf, file_size,
+                      verify ? &hasher : nullptr))
+        return false;
+
+    bool is_matched{true};
+    if (verify && !receive_digest_trailer(fd, hasher.finish(), is_matched))
+        return false;
+
+    bytes += file_size;
+    return is_matched;
+}
+
+[[nodiscard]] static bool bench_put(int fd, const std::string &local_path,
+                                    const std::string &name, std::size_t size,
+                                    char *buf, bool verify,
+                                    std::uint64_t &bytes)
+{
+    std::uint8_t status{
+        static_cast<std::uint8_t>(verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1)};
+    myftp_head head_buf;
+    if (!send_request(fd, MYFTP_HEAD_TYPE::PUT_REQUEST, status, name) ||
+        !head_buf.get(fd) || head_buf.get_type() != MYFTP_HEAD_TYPE::PUT_REPLY)
+        return false;
+
+    head_buf.pack(MYFTP_HEAD_TYPE::FILE_DATA, 1, MYFTP_HEAD_SIZE + size);
+    sha256_hasher hasher;
+    if (!head_buf.send(fd) ||
+        !send_file(fd, local_path.c_str(), buf, size, {},
+                   verify ? &hasher : nullptr))
+        return false;
+
+    if (verify && (!myftp_digest_trailer{hasher.finish()}.send(fd) ||
+                   !head_buf.get(fd) ||
+                   head_buf.get_type() != MYFTP_HEAD_TYPE::PUT_REPLY ||
+                   head_buf.get_status() != 1))
+        return false;
+
+    bytes += size;
+    return true;
+}
+
+[[nodiscard]] static bool read_reply_payload(int fd, std::size_t size,
+                                             char *buf)
+{
+    for (std::size_t remain{size}; remain > 0;)
+    {
+        std::size_t length{std::min(remain, BUF_SIZE)};
+        if (file_process::read(fd, buf, length) != length)
+            return false;
+        remain -= length;
+    }
+    return true;
+}
+
+[[nodiscard]] static bool bench_list(int fd, char *buf)
+{
+    myftp_head head_buf;
+    return LIST_REQUEST.send(fd) && head_buf.get(fd) &&
+           head_buf.get_type() == MYFTP_HEAD_TYPE::LIST_REPLY &&
+           read_reply_payload(fd, head_buf.get_payload_length(), buf);
+}
+
+[[nodiscard]] static bool bench_sha(int fd, const std::string &name, char *buf)
+{
+    myftp_head head_buf;
+    if (!send_request(fd, MYFTP_HEAD_TYPE::SHA_REQUEST, 1, name) ||
+        !head_buf.get(fd) || head_buf.get_type() != MYFTP_HEAD_TYPE::SHA_REPLY ||
+        head_buf.get_status() != 1)
+        return false;
+
+    return head_buf.get(fd) &&
+           head_buf.get_type() == MYFTP_HEAD_TYPE::FILE_DATA &&
+           read_reply_payload(fd, head_buf.get_payload_length(), buf);
+}
+
+static void bench_worker(const bench_config &config,
+                         const std::string &local_dir, std::size_t index,
+                         bool is_uploader,
+                         std::chrono::steady_clock::time_point deadline,
+                         worker_samples &samples)
+{
+    std::vector<char> buf(BUF_SIZE);
+    std::mt19937_64 random{index};
+    std::discrete_distribution<std::size_t> pick_op(config.mix.begin(),
+                                                    config.mix.end());
+    std::vector<double> size_weights;
+    for (const auto &size : config.sizes)
+        size_weights.push_back(size.weight);
+    std::discrete_distribution<std::size_t> pick_size(size_weights.begin(),
+                                                      size_weights.end());
+
+    int fd{-1};
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto op{is_uploader ? BENCH_OP::PUT
+                            : static_cast<BENCH_OP>(pick_op(random))};
+        std::size_t size{is_uploader ? config.upload_size
+                                     : config.sizes[pick_size(random)].size};
+        op_samples &sample{samples[static_cast<std::size_t>(op)]};
+
+        if (fd < 0 && (fd = open_session(config)) < 0)
+        {
+            ++sample.errors;
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            continue;
+        }
+
+        auto start{std::chrono::steady_clock::now()};
+        bool is_ok{false};
+        switch (op)
+        {
+        case BENCH_OP::GET:
+            is_ok = bench_get(fd, remote_name(size), buf.data(), config.verify,
+                              sample.bytes);
+            break;
+        case BENCH_OP::PUT:
+            is_ok = bench_put(fd, local_dir + "/" + remote_name(size),
+                              remote_name(size) + "_put_" +
+                                  std::to_string(index),
+                              size, buf.data(), config.verify, sample.bytes);
+            break;
+        case BENCH_OP::LIST:
+            is_ok = bench_list(fd, buf.data());
+            break;
+        case BENCH_OP::SHA:
+            is_ok = bench_sha(fd, remote_name(size), buf.data());
+            break;
+        default:
+            break;
+        }
+        auto latency{std::chrono::steady_clock::now() - start};
+
+        if (!is_ok)
+        {
+            ++sample.errors;
+            file_process::close(fd);
+            fd = -1;
+            continue;
+        }
+        sample.latencies_ns.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(latency)
+                .count());
+    }
+
+    if (fd >= 0)
+    {
+        bool make_gcc_happy [[maybe_unused]]{QUIT_REQUEST.send(fd)};
+        file_process::close(fd);
+    }
+}
+
+[[nodiscard]] static bool prepare_files(const bench_config &config,
+                                        const std::string &local_dir)
+{
+    int fd{open_session(config)};
+    if (fd < 0)
+        return false;
+
+    std::vector<char> buf(BUF_SIZE);
+    std::mt19937_64 random{0};
+    bool is_ok{true};
+
+    std::vector<weighted_size> sizes{config.sizes};
+    if (config.uploaders > 0)
+        sizes.push_back({config.upload_size, 0});
+
+    for (const auto &size : sizes)
+    {
+        std::string local_path{local_dir + "/" + remote_name(size.size)};
+        FILE_ptr file{std::fopen(local_path.c_str(), "wb")};
+        if (!file.is_valid())
+        {
+            is_ok = false;
+            break;
+        }
+        for (std::size_t written{0}; written < size.size;)
+        {
+            std::size_t length{std::min(BUF_SIZE, size.size - written)};
+            for (std::size_t i{0}; i < length; ++i)
+                buf[i] = static_cast<char>(random());
+            std::fwrite(buf.data(), 1, length, file.get_ptr());
+            written += length;
+        }
+        std::fflush(file.get_ptr());
+
+        std::uint64_t bytes{0};
+        if (!bench_put(fd, local_path, remote_name(size.size), size.size,
+                       buf.data(), false, bytes))
+        {
+            is_ok = false;
+            break;
+        }
+    }
+
+    bool make_gcc_happy [[maybe_unused]]{QUIT_REQUEST.send(fd)};
+    file_process::close(fd);
+    return is_ok;
+}
+
+static double percentile_us(const std::vector<std::uint64_t> &sorted, double q)
+{
+    if (sorted.empty())
+        return 0;
+    std::size_t index{std::min(sorted.size() - 1,
+                               static_cast<std::size_t>(q * sorted.size()))};
+    return sorted[index] / 1e3;
+}
+
+// Prints the JSON report and returns the number of failed operations.
+static std::uint64_t print_report(const bench_config &config,
+                                  std::vector<worker_samples> &all_samples,
+                                  double elapsed)
+{
+    std::uint64_t total_ops{0}, total_bytes{0}, total_errors{0};
+    std::vector<std::uint64_t> all_latencies;
+
+    std::printf("{\n  \"config\": {\"concurrency\": %zu, "
+                "\"uploaders\": %zu, \"upload_size\": %zu, "
+                "\"duration_s\": %.3f, "
+                "\"verify\": %s},\n",
+                config.concurrency, config.uploaders, config.upload_size,
+                config.duration, config.verify ? "true" : "false");
+    std::printf("  \"ops\": {");
+
+    for (std::size_t op{0}; op < N_BENCH_OPS; ++op)
+    {
+        op_samples merged;
+        for (auto &samples : all_samples)
+        {
+            auto &sample{samples[op]};
+            merged.latencies_ns.insert(merged.latencies_ns.end(),
+                                       sample.latencies_ns.begin(),
+                                       sample.latencies_ns.end());
+            merged.errors += sample.errors;
+            merged.bytes += sample.bytes;
+        }
+        std::sort(merged.latencies_ns.begin(), merged.latencies_ns.end());
+
+        std::printf("%s\n    \"%s\": {\"count\": %zu, \"errors\": %llu, "
+                    "\"ops_per_s\": %.1f, \"bytes\": %llu, "
+                    "\"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f}",
+                    op == 0 ? "" : ",", BENCH_OP_NAMES[op].data(),
+                    merged.latencies_ns.size(),
+                    static_cast<unsigned long long>(merged.errors),
+                    merged.latencies_ns.size() / elapsed,
+                    static_cast<unsigned long long>(merged.bytes),
+                    percentile_us(merged.latencies_ns, 0.5),
+                    percentile_us(merged.latencies_ns, 0.99),
+                    percentile_us(merged.latencies_ns, 0.999));
+
+        total_ops += merged.latencies_ns.size();
+        total_bytes += merged.bytes;
+        total_errors += merged.errors;
+        all_latencies.insert(all_latencies.end(), merged.latencies_ns.begin(),
+                             merged.latencies_ns.end());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+
+    std::printf("\n  },\n  \"total\": {\"elapsed_s\": %.3f, \"ops\": %llu, "
+                "\"errors\": %llu, \"ops_per_s\": %.1f, \"gib_per_s\": %.4f, "
+                "\"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f}\n}\n",
+                elapsed, static_cast<unsigned long long>(total_ops),
+                static_cast<unsigned long long>(total_errors),
+                total_ops / elapsed, total_bytes / elapsed / (1 << 30),
+                percentile_us(all_latencies, 0.5),
+                percentile_us(all_latencies, 0.99),
+                percentile_us(all_latencies, 0.999));
+    return total_errors;
+}
+
+int main(int argc, char *argv[])
+{
+    std::signal(SIGPIPE, SIG_IGN);
+
+    bench_config config;
+    if (!parse_bench_config(argc, argv, config))
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " --port=PORT [--ip=IP] [--concurrency=N]"
+                     " [--duration=SECONDS] [--mix=get=70,put=20,list=5,sha=5]"
+                     " [--sizes=4K:80,1M:20] [--uploaders=N]"
+                     " [--upload-size=BYTES] [--verify]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string local_dir{
+        (std::filesystem::temp_directory_path() / "ftp_bench.XXXXXX")
+            .string()};
+    if (!::mkdtemp(local_dir.data()))
+    {
+        std::cerr << "Cannot create a temporary directory.\n";
+        return 1;
+    }
+
+    if (!prepare_files(config, local_dir))
+    {
+        std::cerr << "Cannot upload benchmark files to the server.\n";
+        std::filesystem::remove_all(local_dir);
+        return 1;
+    }
+
+    std::size_t n_workers{config.concurrency + config.uploaders};
+    std::vector<worker_samples> all_samples(n_workers);
+    std::vector<std::thread> workers;
+    auto start{std::chrono::steady_clock::now()};
+    auto deadline{start + std::chrono::duration_cast<
+                              std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(config.duration))};
+
+    for (std::size_t i{0}; i < n_workers; ++i)
+        workers.emplace_back(bench_worker, std::cref(config),
+                             std::cref(local_dir), i, i >= config.concurrency,
+                             deadline, std::ref(all_samples[i]));
+    for (auto &worker : workers)
+        worker.join();
+
+    double elapsed{std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count()};
+    std::uint64_t n_errors{print_report(config, all_samples, elapsed)};
+
+    std::filesystem::remove_all(local_dir);
+    return n_errors == 0 ? 0 : 1;
+}
@@ -1,63 +1,97 @@
+#include "async_client.hxx"
+#include "command.hxx"
+#include "dir_sync.hxx"
+#include "file_meta.hxx"
 #include "file_process.hxx"
 #include "socket.hxx"
+#include "sparse_file.hxx"
 #include "tools.hxx"
+#include <algorithm>
+#include <chrono>
 #include <csignal>
+#include <fcntl.h>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <regex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <thread>
-
-enum class COMMAND_TYPE
-{
-    OPEN,
-    LIST,
-    GET,
-    PUT,
-    SHA,
-    QUIT,
-    INVALID
-};
-
-constexpr auto REGEX_FLAG_2{std::regex_constants::ECMAScript |
-                            std::regex_constants::optimize};
-const std::regex LIST_COMMAND_PATTERN{R"(\s*ls\s*)", REGEX_FLAG_2};
-const std::regex OPEN_COMMAND_PATTERN{R"(\s*open\s+(\S+)\s+(\S+)\s*)",
-                                      REGEX_FLAG_2};
-const std::regex SHA_COMMAND_PATTERN{R"(\s*sha256\s+(\S+)\s*)", REGEX_FLAG_2};
-const std::regex QUIT_COMMAND_PATTERN{R"(\s*quit\s*)", REGEX_FLAG_2};
-const std::regex GET_COMMAND_PATTERN{R"(\s*get\s+(\S+)\s*)", REGEX_FLAG_2};
-const std::regex PUT_COMMAND_PATTERN{R"(\s*put\s+(\S+)\s*)", REGEX_FLAG_2};
+#include <vector>
 
 void ftp_client_loop();
+int ftp_client_batch(std::istream &input, bool fail_fast);
 void connected_function(int fd_to_server, std::string_view ip,
                         std::string_view port);
 
-std::tuple<COMMAND_TYPE, std::string_view, std::string_view>
-parse_command(std::string_view command);
-
 int open_connection(const char *ip, const char *port);
 
 [[nodiscard]] bool list(int fd_to_server, char *buf);
+[[nodiscard]] bool meta_list(int fd_to_server, std::string_view prefix,
+                             std::uint8_t flags);
+void sync(std::string_view ip, std::string_view port, std::string_view prefix,
+          bool verify);
+[[nodiscard]] bool stats(int fd_to_server, char *buf);
 [[nodiscard]] bool quit(int fd_to_server);
+[[nodiscard]] bool copy_or_move(int fd_to_server, std::string_view source,
+                                std::string_view target, bool is_move);
 [[nodiscard]] bool sha256(int fd_to_server, std::string_view file_name,
-                          char *buf);
+                          char *buf, std::uint8_t flags = 1);
+[[nodiscard]] bool sha256_batch(int fd_to_server,
+                                const std::vector<std::string_view> &patterns,
+                                char *buf);
 [[nodiscard]] bool upload_file(int fd_to_server, std::string_view file_name,
-                               char *buf);
+                               char *buf, bool verify);
 [[nodiscard]] bool download_file(int fd_to_server, std::string_view file_name,
-                                 char *buf);
+                                 char *buf, bool verify);
 
-int main()
+int main(int argc, char **argv)
 {
     std::signal(SIGPIPE, SIG_IGN);
-    ftp_client_loop();
-    return 0;
+
+    const char *batch_path{nullptr};
+    bool fail_fast{true};
+    for (int i{1}; i < argc; ++i)
+    {
+        std::string_view arg{argv[i]};
+        if (arg.starts_with("--batch="))
+            batch_path = argv[i] + std::strlen("--batch=");
+        else if (arg == "--fail-fast")
+            fail_fast = true;
+        else if (arg == "--continue")
+            fail_fast = false;
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--batch=<file>|--batch=-] [--fail-fast|--continue]"
+                         "\n";
+            return 1;
+        }
+    }
+
+    if (!batch_path)
+    {
+        ftp_client_loop();
+        return 0;
+    }
+
+    std::ios::sync_with_stdio(false);
+    if (std::string_view{batch_path} == "-")
+        return ftp_client_batch(std::cin, fail_fast);
+
+    std::ifstream input{batch_path};
+    if (!input)
+    {
+        std::cerr << "Cannot open batch file `" << batch_path << "'.\n";
+        return 1;
+    }
+    return ftp_client_batch(input, fail_fast);
 }
 
 constexpr std::string_view PROMPT{"client "};
@@ -103,6 +137,7 @@ void connected_function(int fd_to_server, std::string_view ip,
     char buf[BUF_SIZE];
 
     std::string command;
+    bool verify{false};
 
     while (true)
     {
@@ -120,20 +155,40 @@ void connected_function(int fd_to_server, std::string_view ip,
                 return;
             }
             break;
+        case COMMAND_TYPE::META_LIST:
+        case COMMAND_TYPE::META_LIST_RECURSIVE:
+            if (!meta_list(fd_to_server, str_1,
+                           command_type == COMMAND_TYPE::META_LIST_RECURSIVE
+                               ? 1 | MYFTP_FLAG_RECURSIVE
+                               : 1))
+            {
+                std::cout << "List file error.\n";
+                return;
+            }
+            break;
         case COMMAND_TYPE::GET:
-            if (!download_file(fd_to_server, str_1, buf))
+            if (!download_file(fd_to_server, str_1, buf, verify))
             {
                 std::cout << "Download file error.\n";
                 return;
             }
             break;
         case COMMAND_TYPE::PUT:
-            if (!upload_file(fd_to_server, str_1, buf))
+            if (!upload_file(fd_to_server, str_1, buf, verify))
             {
                 std::cout << "Upload file error.\n";
                 return;
             }
             break;
+        case COMMAND_TYPE::COPY:
+        case COMMAND_TYPE::MOVE:
+            if (!copy_or_move(fd_to_server, str_1, str_2,
+                              command_type == COMMAND_TYPE::MOVE))
+            {
+                std::cout << "Copy file error.\n";
+                return;
+            }
+            break;
         case COMMAND_TYPE::SHA:
             if (!sha256(fd_to_server, str_1, buf))
             {
@@ -141,6 +196,35 @@ void connected_function(int fd_to_server, std::string_view ip,
                 return;
             }
             break;
+        case COMMAND_TYPE::SHA_BATCH:
+            if (!sha256_batch(fd_to_server, split_arguments(str_1), buf))
+            {
+                std::cout << "Sha256 sum file error.\n";
+                return;
+            }
+            break;
+        case COMMAND_TYPE::MERKLE:
+            if (!sha256(fd_to_server, str_1, buf, 1 | MYFTP_FLAG_MERKLE_TREE))
+            {
+                std::cout << "Sha256 sum file error.\n";
+                return;
+            }
+            break;
+        case COMMAND_TYPE::STATS:
+            if (!stats(fd_to_server, buf))
+            {
+                std::cout << "Stats error.\n";
+                return;
+            }
+            break;
+        case COMMAND_TYPE::SYNC:
+            sync(ip, port, str_1, verify);
+            break;
+        case COMMAND_TYPE::VERIFY:
+            verify = str_1 == "on";
+            std::cout << "Transfer verification "
+                      << (verify ? "enabled" : "disabled") << ".\n";
+            break;
         case COMMAND_TYPE::QUIT:
             if (!quit(fd_to_server))
                 std::cout << "Quit error.\n";
@@ -152,6 +236,377 @@ void connected_function(int fd_to_server, std::string_view ip,
     }
 }
 
+static std::string format_file_meta(const std::vector<file_meta> &records)
+{
+    std::string text;
+    char fixed[64];
+    for (const file_meta &meta : records)
+    {
+        std::snprintf(fixed, sizeof(fixed), "%06o %12llu %19lld ",
+                      static_cast<unsigned>(meta.mode),
+                      static_cast<unsigned long long>(meta.size),
+                      static_cast<long long>(meta.mtime_ns));
+        text += fixed;
+        text += meta.digest ? to_hex(*meta.digest) : std::string{"-"};
+        text += ' ';
+        text += meta.name;
+        text += '\n';
+    }
+    return text;
+}
+
+static std::string
+format_file_digests(const std::vector<myftp::file_digest> &digests)
+{
+    std::string text;
+    for (const myftp::file_digest &entry : digests)
+    {
+        if (entry.digest)
+        {
+            text += to_hex(*entry.digest);
+            text += "  ";
+            text += entry.name;
+            text += '\n';
+        }
+        else
+        {
+            text += entry.name;
+            text += ": FAILED open or read\n";
+        }
+    }
+    return text;
+}
+
+static std::string format_sync_report(const myftp::sync_report &report)
+{
+    constexpr std::string_view ACTION_NAMES[]{"put", "get", "delete-local",
+                                              "delete-remote", "same"};
+
+    if (!report.is_listed)
+        return "Sync failed: cannot list remote files.\n";
+
+    std::string text;
+    for (const myftp::sync_change &change : report.changes)
+    {
+        text += ACTION_NAMES[static_cast<std::size_t>(change.action)];
+        text += ' ';
+        text += change.name;
+        text += ' ';
+        text += std::to_string(change.size);
+        if (change.is_conflict)
+            text += " conflict";
+        if (change.status != myftp::TRANSFER_STATUS::OK)
+            text += " failed";
+        text += '\n';
+    }
+    text += "Transferred " + std::to_string(report.bytes_transferred) +
+            " bytes, saved " + std::to_string(report.bytes_saved()) + " of " +
+            std::to_string(report.bytes_full_copy) +
+            " bytes for a full copy, " + std::to_string(report.n_failed()) +
+            " failed.\n";
+    return text;
+}
+
+static myftp::task<void> sync_function(myftp::event_loop &loop,
+                                       std::string host, std::string port,
+                                       myftp::sync_options options,
+                                       myftp::sync_report &report)
+{
+    report = co_await myftp::sync_directory(loop, std::move(host),
+                                            std::move(port),
+                                            std::move(options));
+}
+
+void sync(std::string_view ip, std::string_view port, std::string_view prefix,
+          bool verify)
+{
+    myftp::event_loop loop;
+    myftp::sync_report report{};
+    myftp::sync_options options;
+    options.prefix = prefix;
+    options.verify = verify;
+
+    loop.spawn(sync_function(loop, std::string{ip}, std::string{port},
+                             std::move(options), report));
+    loop.run();
+
+    std::cout << "------Sync result------\n";
+    std::cout << format_sync_report(report);
+    std::cout << "----Sync result end----\n";
+}
+
+struct batch_context
+{
+    std::optional<myftp::session> session;
+    std::string host;
+    std::string port;
+    bool verify{false};
+};
+
+struct batch_result
+{
+    std::string_view status{"ok"};
+    std::size_t bytes{0};
+    std::optional<std::string> output;
+};
+
+static std::string_view status_name(myftp::TRANSFER_STATUS status)
+{
+    switch (status)
+    {
+    case myftp::TRANSFER_STATUS::OK:
+        return "ok";
+    case myftp::TRANSFER_STATUS::NOT_FOUND:
+        return "not_found";
+    case myftp::TRANSFER_STATUS::DIGEST_MISMATCH:
+        return "digest_mismatch";
+    default:
+        return "error";
+    }
+}
+
+static void append_json_string(std::string &out, std::string_view text)
+{
+    constexpr char HEX[]{"0123456789abcdef"};
+
+    out += '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out += HEX[(c >> 4) & 0xf];
+                out += HEX[c & 0xf];
+            }
+            else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+static std::size_t local_file_size(std::string_view file_name)
+{
+    std::error_code ec;
+    std::size_t size{std::filesystem::file_size(file_name, ec)};
+    return ec ? 0 : size;
+}
+
+static myftp::task<batch_result>
+run_batch_command(myftp::event_loop &loop, batch_context &context,
+                  COMMAND_TYPE command_type, std::string arg_1,
+                  std::string arg_2)
+{
+    batch_result result;
+    std::optional<myftp::session> &session{context.session};
+    bool verify{context.verify};
+
+    switch (command_type)
+    {
+    case COMMAND_TYPE::OPEN:
+        session.reset();
+        session = co_await myftp::session::open(loop, arg_1.c_str(),
+                                                arg_2.c_str());
+        if (!session)
+            result.status = "error";
+        context.host = std::move(arg_1);
+        context.port = std::move(arg_2);
+        co_return result;
+    case COMMAND_TYPE::VERIFY:
+        context.verify = arg_1 == "on";
+        co_return result;
+    case COMMAND_TYPE::INVALID:
+        result.status = "invalid";
+        co_return result;
+    default:
+        break;
+    }
+
+    if (!session)
+    {
+        result.status = "not_connected";
+        co_return result;
+    }
+
+    if (command_type == COMMAND_TYPE::SYNC)
+    {
+        myftp::sync_options options;
+        options.prefix = std::move(arg_1);
+        options.verify = verify;
+        myftp::sync_report report{co_await myftp::sync_directory(
+            loop, context.host, context.port, std::move(options))};
+        if (!report.is_listed || report.n_failed() > 0)
+            result.status = "error";
+        result.bytes = report.bytes_transferred;
+        result.output = format_sync_report(report);
+        co_return result;
+    }
+
+    switch (command_type)
+    {
+    case COMMAND_TYPE::LIST:
+        result.output = co_await session->list();
+        if (!result.output)
+            result.status = "error";
+        break;
+    case COMMAND_TYPE::META_LIST:
+    case COMMAND_TYPE::META_LIST_RECURSIVE:
+    {
+        auto records{co_await session->meta_list(
+            arg_1, command_type == COMMAND_TYPE::META_LIST_RECURSIVE)};
+        if (records)
+            result.output = format_file_meta(*records);
+        else
+            result.status = "error";
+        break;
+    }
+    case COMMAND_TYPE::STATS:
+        result.output = co_await session->stats();
+        if (!result.output)
+            result.status = "error";
+        break;
+    case COMMAND_TYPE::GET:
+        result.status =
+            status_name(co_await session->get(arg_1, arg_1, verify));
+        if (result.status == "ok")
+            result.bytes = local_file_size(arg_1);
+        break;
+    case COMMAND_TYPE::PUT:
+        result.status =
+            status_name(co_await session->put(arg_1, arg_1, verify));
+        if (result.status == "ok")
+            result.bytes = local_file_size(arg_1);
+        break;
+    case COMMAND_TYPE::COPY:
+        result.status = status_name(co_await session->copy(arg_1, arg_2));
+        break;
+    case COMMAND_TYPE::MOVE:
+        result.status = status_name(co_await session->move(arg_1, arg_2));
+        break;
+    case COMMAND_TYPE::SHA:
+    case COMMAND_TYPE::MERKLE:
+    {
+        std::uint8_t flags{static_cast<std::uint8_t>(
+            command_type == COMMAND_TYPE::MERKLE ? 1 | MYFTP_FLAG_MERKLE_TREE
+                                                 : 1)};
+        auto reply{co_await session->sha256(arg_1, flags)};
+        result.status = status_name(reply.status);
+        if (reply.status == myftp::TRANSFER_STATUS::OK)
+            result.output = std::move(reply.text);
+        break;
+    }
+    case COMMAND_TYPE::SHA_BATCH:
+    {
+        std::vector<std::string> patterns;
+        for (std::string_view pattern : split_arguments(arg_1))
+            patterns.emplace_back(pattern);
+        auto digests{co_await session->sha256_batch(std::move(patterns))};
+        if (!digests)
+        {
+            result.status = "error";
+            break;
+        }
+        result.output = format_file_digests(*digests);
+        if (std::any_of(digests->begin(), digests->end(),
+                        [](const myftp::file_digest &entry)
+                        { return !entry.digest; }))
+            result.status = "not_found";
+        break;
+    }
+    case COMMAND_TYPE::QUIT:
+        if (!co_await session->quit())
+            result.status = "error";
+        session.reset();
+        break;
+    default:
+        break;
+    }
+
+    if (result.status == "error")
+        session.reset();
+    co_return result;
+}
+
+static myftp::task<void> batch_function(myftp::event_loop &loop,
+                                        std::istream &input, bool fail_fast,
+                                        std::size_t &n_failed)
+{
+    batch_context context;
+    std::string command, line;
+
+    for (std::size_t line_number{1}; std::getline(input, command);
+         ++line_number)
+    {
+        std::size_t first{command.find_first_not_of(" \t\r")};
+        if (first == std::string::npos || command[first] == '#')
+            continue;
+
+        auto start{std::chrono::steady_clock::now()};
+        auto [command_type, str_1, str_2]{parse_command(command)};
+        batch_result result{co_await run_batch_command(
+            loop, context, command_type, std::string{str_1},
+            std::string{str_2})};
+        auto elapsed{std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)};
+
+        line.clear();
+        line += "{\"line\":";
+        line += std::to_string(line_number);
+        line += ",\"command\":";
+        append_json_string(line, command);
+        line += ",\"status\":\"";
+        line += result.status;
+        line += "\",\"elapsed_us\":";
+        line += std::to_string(elapsed.count());
+        line += ",\"bytes\":";
+        line += std::to_string(result.bytes);
+        if (result.output)
+        {
+            line += ",\"output\":";
+            append_json_string(line, *result.output);
+        }
+        line += "}\n";
+        std::cout << line;
+
+        if (result.status != "ok")
+        {
+            ++n_failed;
+            if (fail_fast)
+                break;
+        }
+    }
+
+    if (context.session)
+        co_await context.session->quit();
+}
+
+int ftp_client_batch(std::istream &input, bool fail_fast)
+{
+    myftp::event_loop loop;
+    std::size_t n_failed{0};
+
+    loop.spawn(batch_function(loop, input, fail_fast, n_failed));
+    loop.run();
+    std::cout.flush();
+
+    return n_failed == 0 ? 0 : 1;
+}
+
 int open_connection(const char *ip, const char *port)
 {
     myftp_head head_buf;
@@ -185,9 +640,9 @@ int open_connection(const char *ip, const char *port)
 }
 
 [[nodiscard]] bool sha256(int fd_to_server, std::string_view file_name,
-                          char *buf)
+                          char *buf, std::uint8_t flags)
 {
-    myftp_head head_buf(MYFTP_HEAD_TYPE::SHA_REQUEST, 1,
+    myftp_head head_buf(MYFTP_HEAD_TYPE::SHA_REQUEST, flags,
                         MYFTP_HEAD_SIZE + file_name.length() + 1);
     if (!head_buf.send(fd_to_server))
         return false;
@@ -211,18 +666,84 @@ int open_connection(const char *ip, const char *port)
             head_buf.get_type() != MYFTP_HEAD_TYPE::FILE_DATA)
             return false;
 
-        if (file_process::read(fd_to_server, buf,
-                               head_buf.get_payload_length()) !=
-            head_buf.get_payload_length())
-            return false;
-
         std::cout << "------Sha256 result------\n";
-        std::cout << buf;
+        for (std::size_t remain{head_buf.get_payload_length()}; remain > 0;)
+        {
+            std::size_t length{std::min(remain, BUF_SIZE)};
+            if (file_process::read(fd_to_server, buf, length) != length)
+                return false;
+            std::cout.write(buf, length - (remain == length));
+            remain -= length;
+        }
         std::cout << "----Sha256 result end----\n";
     }
     return true;
 }
 
+[[nodiscard]] bool sha256_batch(int fd_to_server,
+                                const std::vector<std::string_view> &patterns,
+                                char *buf)
+{
+    std::string payload;
+    for (std::string_view pattern : patterns)
+    {
+        payload += pattern;
+        payload.push_back('\0');
+    }
+    if (payload.size() > MAX_SHA_BATCH_PAYLOAD)
+    {
+        std::cout << "Too many sha256 patterns.\n";
+        return true;
+    }
+
+    myftp_head head_buf(MYFTP_HEAD_TYPE::SHA_BATCH_REQUEST, 1,
+                        MYFTP_HEAD_SIZE + payload.size());
+    if (!head_buf.send(fd_to_server) ||
+        file_process::write(fd_to_server, payload.data(), payload.size()) !=
+            payload.size())
+        return false;
+
+    if (!head_buf.get(fd_to_server) ||
+        head_buf.get_type() != MYFTP_HEAD_TYPE::SHA_BATCH_REPLY)
+        return false;
+    if (head_buf.get_status() != 1)
+    {
+        std::cout << "Invalid sha256 batch request.\n";
+        return true;
+    }
+
+    std::cout << "------Sha256 result------\n";
+    for (;;)
+    {
+        if (!head_buf.get(fd_to_server) ||
+            head_buf.get_type() != MYFTP_HEAD_TYPE::FILE_DATA)
+            return false;
+        std::size_t length{head_buf.get_payload_length()};
+        if (length == 0)
+            break;
+        if (length > BUF_SIZE ||
+            file_process::read(fd_to_server, buf, length) != length)
+            return false;
+
+        if (head_buf.get_status() != 1)
+            std::cout << std::string_view{buf, length}
+                      << ": FAILED open or read\n";
+        else if (length > SHA256_DIGEST_SIZE)
+        {
+            sha256_digest digest;
+            std::memcpy(digest.data(), buf, SHA256_DIGEST_SIZE);
+            std::cout << to_hex(digest) << "  "
+                      << std::string_view{buf + SHA256_DIGEST_SIZE,
+                                          length - SHA256_DIGEST_SIZE}
+                      << '\n';
+        }
+        else
+            return false;
+    }
+    std::cout << "----Sha256 result end----\n";
+    return true;
+}
+
 [[nodiscard]] bool list(int fd_to_server, char *buf)
 {
 
@@ -245,6 +766,65 @@ int open_connection(const char *ip, const char *port)
     return true;
 }
 
+[[nodiscard]] bool meta_list(int fd_to_server, std::string_view prefix,
+                             std::uint8_t flags)
+{
+    myftp_head head_buf(MYFTP_HEAD_TYPE::META_LIST_REQUEST, flags,
+                        MYFTP_HEAD_SIZE + prefix.length() + 1);
+    if (!head_buf.send(fd_to_server))
+        return false;
+    if (file_process::write(fd_to_server, prefix.data(), prefix.length()) !=
+            prefix.length() ||
+        file_process::write(fd_to_server, "\0", 1) != 1)
+        return false;
+
+    if (!head_buf.get(fd_to_server) ||
+        head_buf.get_type() != MYFTP_HEAD_TYPE::META_LIST_REPLY)
+        return false;
+
+    std::string payload(head_buf.get_payload_length(), '\0');
+    if (file_process::read(fd_to_server, payload.data(), payload.size()) !=
+        payload.size())
+        return false;
+
+    std::vector<file_meta> records;
+    if (head_buf.get_status() != 1 || !parse_file_meta(payload, records))
+    {
+        std::cout << "Remote listing failed.\n";
+        return true;
+    }
+
+    std::cout << "------List of files------\n";
+    std::cout << format_file_meta(records);
+    std::cout << "----List of files end----\n";
+
+    return true;
+}
+
+[[nodiscard]] bool stats(int fd_to_server, char *buf)
+{
+    myftp_head head_buf;
+    if (!STATS_REQUEST.send(fd_to_server))
+        return false;
+
+    if (!head_buf.get(fd_to_server) ||
+        head_buf.get_type() != MYFTP_HEAD_TYPE::STATS_REPLY)
+        return false;
+
+    std::cout << "------Server statistics------\n";
+    for (std::size_t remain{head_buf.get_payload_length()}; remain > 0;)
+    {
+        std::size_t length{std::min(remain, BUF_SIZE)};
+        if (file_process::read(fd_to_server, buf, length) != length)
+            return false;
+        std::cout.write(buf, length - (remain == length));
+        remain -= length;
+    }
+    std::cout << "----Server statistics end----\n";
+
+    return true;
+}
+
 [[nodiscard]] bool quit(int fd_to_server)
 {
     myftp_head head_buf;
@@ -262,21 +842,66 @@ int open_connection(const char *ip, const char *port)
     return true;
 }
 
+[[nodiscard]] bool copy_or_move(int fd_to_server, std::string_view source,
+                                std::string_view target, bool is_move)
+{
+    myftp_head head_buf(is_move ? MYFTP_HEAD_TYPE::MOVE_REQUEST
+                                : MYFTP_HEAD_TYPE::COPY_REQUEST,
+                        1,
+                        MYFTP_HEAD_SIZE + source.length() + target.length() +
+                            2);
+    if (!head_buf.send(fd_to_server))
+        return false;
+    if (file_process::write(fd_to_server, source.data(), source.length()) !=
+            source.length() ||
+        file_process::write(fd_to_server, "\0", 1) != 1 ||
+        file_process::write(fd_to_server, target.data(), target.length()) !=
+            target.length() ||
+        file_process::write(fd_to_server, "\0", 1) != 1)
+        return false;
+
+    if (!head_buf.get(fd_to_server) ||
+        head_buf.get_type() != (is_move ? MYFTP_HEAD_TYPE::MOVE_REPLY
+                                        : MYFTP_HEAD_TYPE::COPY_REPLY))
+        return false;
+
+    if (head_buf.get_status() == 1)
+        std::cout << (is_move ? "Moved `" : "Copied `") << source << "' to `"
+                  << target << "'.\n";
+    else
+        std::cout << "Cannot " << (is_move ? "move" : "copy") << " `"
+                  << source << "' to `" << target << "'.\n";
+    return true;
+}
+
 [[nodiscard]] bool upload_file(int fd_to_server, std::string_view file_name,
-                               char *buf)
+                               char *buf, bool verify)
 {
     std::string file_name_str(file_name);
 
-    if (!std::filesystem::is_regular_file(file_name_str))
+    struct stat file_stat;
+    if (::stat(file_name_str.c_str(), &file_stat) != 0 ||
+        !S_ISREG(file_stat.st_mode))
     {
         std::cout << "Local file `" << file_name_str
                   << "' does not exist, or is not a regular file.\n";
         return true;
     }
 
-    std::size_t file_size{std::filesystem::file_size(file_name_str)};
+    std::size_t file_size{static_cast<std::size_t>(file_stat.st_size)};
+
+    file_descriptor file{
+        is_sparse(file_stat) ? ::open(file_name_str.c_str(), O_RDONLY | O_CLOEXEC)
+                             : -1};
+    sparse_map map;
+    bool is_sparse_upload{file.is_valid() &&
+                          map_data_extents(file.get(), file_size, map)};
 
-    myftp_head head_buf(MYFTP_HEAD_TYPE::PUT_REQUEST, 1,
+    std::uint8_t status{static_cast<std::uint8_t>(
+        (verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1) |
+        (is_sparse_upload ? MYFTP_FLAG_SPARSE : 0))};
+
+    myftp_head head_buf(MYFTP_HEAD_TYPE::PUT_REQUEST, status,
                         MYFTP_HEAD_SIZE + file_name_str.length() + 1);
     if (!head_buf.send(fd_to_server))
         return false;
@@ -289,24 +914,50 @@ int open_connection(const char *ip, const char *port)
     if (!head_buf.get(fd_to_server) ||
         head_buf.get_type() != MYFTP_HEAD_TYPE::PUT_REPLY)
         return false;
+    is_sparse_upload =
+        is_sparse_upload && (head_buf.get_status() & MYFTP_FLAG_SPARSE);
+
+    sha256_hasher hasher;
+    if (is_sparse_upload)
+    {
+        if (!send_sparse_file(fd_to_server, file.get(), map, buf,
+                              verify ? &hasher : nullptr))
+            return false;
+    }
+    else
+    {
+        head_buf.pack(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                      MYFTP_HEAD_SIZE + file_size);
+        if (!head_buf.send(fd_to_server) ||
+            !send_file(fd_to_server, file_name_str.c_str(), buf, file_size,
+                       {}, verify ? &hasher : nullptr))
+            return false;
+    }
 
-    head_buf.pack(MYFTP_HEAD_TYPE::FILE_DATA, 1, MYFTP_HEAD_SIZE + file_size);
+    if (!verify)
+        return true;
 
-    if (!head_buf.send(fd_to_server))
+    if (!myftp_digest_trailer{hasher.finish()}.send(fd_to_server))
         return false;
 
-    if (!send_file(fd_to_server, file_name_str.c_str(), buf, file_size))
+    if (!head_buf.get(fd_to_server) ||
+        head_buf.get_type() != MYFTP_HEAD_TYPE::PUT_REPLY)
         return false;
 
+    if (head_buf.get_status() != 1)
+        std::cout << "Remote file `" << file_name
+                  << "' failed verification and was discarded.\n";
     return true;
 }
 
 [[nodiscard]] bool download_file(int fd_to_server, std::string_view file_name,
-                                 char *buf)
+                                 char *buf, bool verify)
 {
     std::string file_name_str(file_name);
+    std::uint8_t status{static_cast<std::uint8_t>(
+        (verify ? 1 | MYFTP_FLAG_DIGEST_TRAILER : 1) | MYFTP_FLAG_SPARSE)};
 
-    myftp_head head_buf(MYFTP_HEAD_TYPE::GET_REQUEST, 1,
+    myftp_head head_buf(MYFTP_HEAD_TYPE::GET_REQUEST, status,
                         MYFTP_HEAD_SIZE + file_name_str.length() + 1);
 
     if (!head_buf.send(fd_to_server))
@@ -328,60 +979,40 @@ int open_connection(const char *ip, const char *port)
                   << "' does not exist, or is not a regular file.\n";
         break;
     case 1:
-        if (!head_buf.get(fd_to_server) ||
-            head_buf.get_type() != MYFTP_HEAD_TYPE::FILE_DATA)
+        if (!head_buf.get(fd_to_server))
+            return false;
+
+        sha256_hasher hasher;
+        switch (head_buf.get_type())
+        {
+        case MYFTP_HEAD_TYPE::FILE_DATA:
+            if (!receive_file(fd_to_server, file_name_str.c_str(), buf,
+                              head_buf.get_payload_length(),
+                              verify ? &hasher : nullptr))
+                return false;
+            break;
+        case MYFTP_HEAD_TYPE::SPARSE_DATA:
+            if (!receive_sparse_file(fd_to_server, file_name_str.c_str(), buf,
+                                     head_buf.get_payload_length(),
+                                     verify ? &hasher : nullptr))
+                return false;
+            break;
+        default:
             return false;
+        }
 
-        if (!receive_file(fd_to_server, file_name_str.c_str(), buf,
-                          head_buf.get_payload_length()))
+        bool is_matched{true};
+        if (verify && !receive_digest_trailer(fd_to_server, hasher.finish(),
+                                              is_matched))
             return false;
+
+        if (std::error_code ec; !is_matched)
+        {
+            std::filesystem::remove(file_name_str, ec);
+            std::cout << "Local file `" << file_name
+                      << "' failed verification and was discarded.\n";
+        }
     }
 
     return true;
 }
-
-std::tuple<COMMAND_TYPE, std::string_view, std::string_view>
-parse_command(std::string_view command)
-{
-    std::cmatch m;
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         OPEN_COMMAND_PATTERN))
-    {
-        if ((!std::regex_match(m[1].first, m[1].second, IPv4_PATTERN) &&
-                !std::regex_match(m[1].first, m[1].second, IPv6_PATTERN)) ||
-            !std::regex_match(m[2].first, m[2].second, PORT_PATTERN))
-            return {COMMAND_TYPE::INVALID, {nullptr, 0}, {nullptr, 0}};
-        return {COMMAND_TYPE::OPEN,
-                {m[1].first, static_cast<std::size_t>(m[1].length())},
-                {m[2].first, static_cast<std::size_t>(m[2].length())}};
-    }
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         LIST_COMMAND_PATTERN))
-        return {COMMAND_TYPE::LIST, {nullptr, 0}, {nullptr, 0}};
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         GET_COMMAND_PATTERN))
-        return {COMMAND_TYPE::GET,
-                {m[1].first, static_cast<std::size_t>(m[1].length())},
-                {nullptr, 0}};
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         PUT_COMMAND_PATTERN))
-        return {COMMAND_TYPE::PUT,
-                {m[1].first, static_cast<std::size_t>(m[1].length())},
-                {nullptr, 0}};
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         SHA_COMMAND_PATTERN))
-        return {COMMAND_TYPE::SHA,
-                {m[1].first, static_cast<std::size_t>(m[1].length())},
-                {nullptr, 0}};
-
-    if (std::regex_match(command.begin(), command.end(), m,
-                         QUIT_COMMAND_PATTERN))
-        return {COMMAND_TYPE::QUIT, {nullptr, 0}, {nullptr, 0}};
-
-    return {COMMAND_TYPE::INVALID, {nullptr, 0}, {nullptr, 0}};
-}
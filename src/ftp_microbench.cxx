@@ -0,0 +1,185 @@
+#include "command.hxx"
+#include "file_process.hxx"
+#include "tools.hxx"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+
+template <typename T> static void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+static void run(std::string_view name, std::size_t iterations, F &&body)
+{
+    for (std::size_t i{0}; i < iterations / 10; ++i)
+        body(i);
+
+    auto start{std::chrono::steady_clock::now()};
+    for (std::size_t i{0}; i < iterations; ++i)
+        body(i);
+    double elapsed_ns{std::chrono::duration<double, std::nano>(
+                          std::chrono::steady_clock::now() - start)
+                          .count()};
+
+    std::printf("%-32.*s %12.2f ns/op\n", static_cast<int>(name.size()),
+                name.data(), elapsed_ns / iterations);
+}
+
+// Baseline myftp_head validation, kept verbatim (including the missing
+// break after GET_REPLY/SHA_REPLY) so head_decode_legacy measures the
+// code that the table-driven parse() replaced.
+class [[gnu::packed]] legacy_head
+{
+private:
+    char m_protocol[MAGIC_NUMBER_LENGTH];
+    MYFTP_HEAD_TYPE m_type;
+    std::uint8_t m_status;
+    std::uint32_t m_length;
+
+public:
+    explicit legacy_head(const myftp_head &head)
+    {
+        std::memcpy(this, &head, MYFTP_HEAD_SIZE);
+    }
+
+    bool is_valid() const;
+    unsigned char get_status() const { return m_status; }
+    std::uint32_t get_length() const { return ntohl(m_length); }
+};
+static_assert(sizeof(legacy_head) == MYFTP_HEAD_SIZE);
+
+bool legacy_head::is_valid() const
+{
+    std::string_view protocol{m_protocol, 6};
+    if (protocol != MYFTP_PROTOCOL)
+        return false;
+
+    switch (m_type)
+    {
+    case MYFTP_HEAD_TYPE::OPEN_CONNECTION_REQUEST:
+    case MYFTP_HEAD_TYPE::LIST_REQUEST:
+    case MYFTP_HEAD_TYPE::PUT_REPLY:
+    case MYFTP_HEAD_TYPE::QUIT_REQUEST:
+    case MYFTP_HEAD_TYPE::QUIT_REPLY:
+        if (get_length() != MYFTP_HEAD_SIZE)
+            return false;
+        break;
+
+    case MYFTP_HEAD_TYPE::OPEN_CONNECTION_REPLY:
+        if (get_status() != 1 || get_length() != MYFTP_HEAD_SIZE)
+            return false;
+        break;
+
+    case MYFTP_HEAD_TYPE::LIST_REPLY:
+    case MYFTP_HEAD_TYPE::GET_REQUEST:
+    case MYFTP_HEAD_TYPE::PUT_REQUEST:
+    case MYFTP_HEAD_TYPE::SHA_REQUEST:
+        if (get_length() <= 13)
+            return false;
+        break;
+
+    case MYFTP_HEAD_TYPE::GET_REPLY:
+    case MYFTP_HEAD_TYPE::SHA_REPLY:
+        if ((get_status() != 0 && get_status() != 1) ||
+            get_length() != MYFTP_HEAD_SIZE)
+            return false;
+
+    case MYFTP_HEAD_TYPE::FILE_DATA:
+        if (get_length() < MYFTP_HEAD_SIZE)
+            return false;
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+int main()
+{
+    constexpr std::size_t N{10'000'000};
+
+    const myftp_head heads[]{
+        {MYFTP_HEAD_TYPE::GET_REQUEST, 1, MYFTP_HEAD_SIZE + 16},
+        {MYFTP_HEAD_TYPE::FILE_DATA, 1, MYFTP_HEAD_SIZE + 4096},
+        {MYFTP_HEAD_TYPE::LIST_REQUEST, 1, MYFTP_HEAD_SIZE},
+        {MYFTP_HEAD_TYPE::INVALID, 1, MYFTP_HEAD_SIZE}};
+
+    run("head_encode", N,
+        [](std::size_t i)
+        {
+            myftp_head head;
+            head.pack(MYFTP_HEAD_TYPE::FILE_DATA, 1, MYFTP_HEAD_SIZE + i);
+            do_not_optimize(head);
+        });
+
+    const legacy_head legacy_heads[]{legacy_head{heads[0]},
+                                     legacy_head{heads[1]},
+                                     legacy_head{heads[2]},
+                                     legacy_head{heads[3]}};
+
+    run("head_decode_legacy", N,
+        [&](std::size_t i)
+        {
+            const legacy_head &head{legacy_heads[i & 3]};
+            bool is_valid{head.is_valid()};
+            std::uint32_t length{head.get_length()};
+            do_not_optimize(is_valid);
+            do_not_optimize(length);
+        });
+
+    run("head_decode_view", N,
+        [&](std::size_t i)
+        {
+            myftp_head_view view{heads[i & 3].parse()};
+            do_not_optimize(view);
+        });
+
+    const std::string_view commands[]{"get some_file.txt", "  ls  ",
+                                      "open 127.0.0.1 2121",
+                                      "sha256 archive.tar", "bogus command"};
+    run("command_parse", N / 20,
+        [&](std::size_t i)
+        {
+            auto result{parse_command(commands[i % 5])};
+            do_not_optimize(result);
+        });
+
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        return 1;
+
+    std::thread echo{[fd{fds[1]}]
+                     {
+                         myftp_head head;
+                         while (head.get(fd) &&
+                                head.get_type() == MYFTP_HEAD_TYPE::LIST_REQUEST)
+                             if (!PUT_REPLY.send(fd))
+                                 break;
+                     }};
+
+    run("small_message_round_trip", N / 100,
+        [&](std::size_t)
+        {
+            myftp_head reply;
+            if (!LIST_REQUEST.send(fds[0]) || !reply.get(fds[0]))
+                std::abort();
+            do_not_optimize(reply);
+        });
+
+    bool make_gcc_happy [[maybe_unused]]{QUIT_REQUEST.send(fds[0])};
+    echo.join();
+    file_process::close(fds[0]);
+    file_process::close(fds[1]);
+    return 0;
+}
@@ -1,51 +1,115 @@
+#include "buffer_pool.hxx"
+#include "direct_io.hxx"
+#include "file_cache.hxx"
+#include "file_copy.hxx"
+#include "file_hash.hxx"
+#include "file_meta.hxx"
+#include "hash_pool.hxx"
 #include "file_process.hxx"
+#include "merkle.hxx"
+#include "metrics.hxx"
+#include "server_config.hxx"
 #include "socket.hxx"
+#include "sparse_file.hxx"
 #include "tools.hxx"
+#include "trace.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <csignal>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <fcntl.h>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <poll.h>
 #include <regex>
 #include <string>
 #include <string_view>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <thread>
+#include <unistd.h>
+#include <vector>
+
+static server_config config;
+static std::unique_ptr<file_cache> content_cache;
+static std::unique_ptr<buffer_pool> io_buffer_pool;
+static std::unique_ptr<hash_pool> hash_workers;
 
 bool check_ip(const char *ip, const char *port);
+void admin_socket_function(int admin_fd);
 void ftp_server_open_connection_function(int fd_to_client);
+[[nodiscard]] bool recover_from_accept_error();
 void ftp_server_main_process_function(int fd_to_client);
 
 [[nodiscard]] bool quit_connection(int fd_to_client);
 [[nodiscard]] bool open_connection(int fd_to_client);
 [[nodiscard]] bool list(int fd_to_client, char *buf);
+[[nodiscard]] bool stats(int fd_to_client);
+[[nodiscard]] bool meta_list(int fd_to_client, char *buf,
+                             std::uint32_t prefix_length, std::uint8_t flags);
+[[nodiscard]] bool delete_file(int fd_to_client, char *buf,
+                               std::uint32_t file_name_length);
+[[nodiscard]] bool copy_or_move_file(int fd_to_client, char *buf,
+                                     std::uint32_t payload_length,
+                                     bool is_move);
 [[nodiscard]] bool sha256(int fd_to_client, char *buf,
-                          std::uint32_t file_name_length);
+                          std::uint32_t file_name_length, std::uint8_t flags);
+[[nodiscard]] bool merkle_sha256(int fd_to_client, std::string_view path);
+[[nodiscard]] bool sha256_batch(int fd_to_client,
+                                std::uint32_t payload_length);
 [[nodiscard]] bool upload_file(int fd_to_client, char *buf,
-                               std::uint32_t file_name_length);
+                               std::uint32_t file_name_length,
+                               std::uint8_t flags);
 [[nodiscard]] bool download_file(int fd_to_client, char *buf,
-                                 std::uint32_t file_name_length);
+                                 std::uint32_t file_name_length,
+                                 std::uint8_t flags);
+[[nodiscard]] bool send_uncached_file(int fd_to_client, std::string_view path,
+                                      const struct stat &file_stat,
+                                      std::uint8_t flags);
 
 int main(int argc, char *argv[])
 {
     std::signal(SIGPIPE, SIG_IGN);
 
-    if (argc != 3)
+    if (!parse_server_config(argc, argv, config) ||
+        !check_ip(config.ip, config.port))
     {
-        std::cerr << "Usage: " << argv[0] << " <ip> <port>" << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " <ip> <port> [--cache-size=BYTES]"
+                     " [--cache-max-entry=BYTES] [--readahead=BYTES]"
+                     " [--drop-behind=BYTES] [--direct-io]"
+                     " [--sync-batch=BYTES] [--hash-threads=N]"
+                     " [--merkle-leaf=BYTES] [--admin-socket=PATH]"
+                     " [--io-buffer=BYTES] [--io-buffer-idle=N]"
+                     " [--huge-pages] [--trace]"
+                  << std::endl;
         return 1;
     }
 
-    const char *ip{argv[1]}, *port{argv[2]};
+    trace::set_enabled(config.trace);
+    if (config.cache_size > 0)
+        content_cache = std::make_unique<file_cache>(
+            config.cache_size, config.cache_max_entry_size);
+    io_buffer_pool = std::make_unique<buffer_pool>(
+        config.io_buffer_size, config.io_buffer_max_idle, config.huge_pages);
+    hash_workers = std::make_unique<hash_pool>(config.hash_threads,
+                                               *io_buffer_pool);
 
-    if (!check_ip(ip, port))
+    if (config.admin_socket)
     {
-        std::cerr << "Usage: " << argv[0] << " <ip> <port>" << std::endl;
-        return 1;
+        int admin_fd{socket_process::open_unix_listen_fd(config.admin_socket)};
+        if (admin_fd < 0)
+            return 1;
+        std::thread(admin_socket_function, admin_fd).detach();
     }
 
-    int listen_fd{socket_process::open_listen_fd(ip, port)};
+    int listen_fd{socket_process::open_listen_fd(config.ip, config.port)};
 
     if (listen_fd < 0)
         return 1;
@@ -57,6 +121,12 @@ int main(int argc, char *argv[])
         int fd_to_client{socket_process::accept(
             listen_fd, reinterpret_cast<sockaddr *>(&client_addr),
             &client_len)};
+        if (fd_to_client < 0)
+        {
+            if (!recover_from_accept_error())
+                return 1;
+            continue;
+        }
 
         std::thread new_thread(ftp_server_open_connection_function,
                                fd_to_client);
@@ -76,6 +146,117 @@ bool check_ip(const char *ip, const char *port)
     return true;
 }
 
+[[nodiscard]] bool recover_from_accept_error()
+{
+    switch (errno)
+    {
+    case EINTR:
+    case ECONNABORTED:
+        return true;
+    case EMFILE:
+    case ENFILE:
+    case ENOBUFS:
+    case ENOMEM:
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        return true;
+    default:
+        return false;
+    }
+}
+
+static std::string render_metrics()
+{
+    if (!content_cache)
+        return metrics::render_prometheus(nullptr);
+
+    file_cache::statistics cache_statistics{content_cache->get_statistics()};
+    return metrics::render_prometheus(&cache_statistics);
+}
+
+// A scrape that shuts down its side is answered at once and a silent one
+// after a short grace period for the first byte of a command. Only a
+// command that has started is given the full timeout to finish.
+static std::string read_admin_command(int fd)
+{
+    constexpr int ADMIN_COMMAND_GRACE_MS{10};
+    constexpr int ADMIN_COMMAND_TIMEOUT_MS{100};
+
+    char command[64];
+    std::size_t size{0};
+    pollfd readable{fd, POLLIN, 0};
+    for (int timeout{ADMIN_COMMAND_GRACE_MS};
+         size < sizeof(command) && ::poll(&readable, 1, timeout) > 0;
+         timeout = ADMIN_COMMAND_TIMEOUT_MS)
+    {
+        ssize_t n{::read(fd, command + size, sizeof(command) - size)};
+        if (n <= 0)
+            break;
+        size += n;
+        if (std::string_view{command, size}.find('\n') !=
+            std::string_view::npos)
+            break;
+    }
+
+    std::string_view text{command, size};
+    return std::string{text.substr(0, text.find_first_of("\r\n"))};
+}
+
+static std::string run_admin_command(std::string_view command)
+{
+    if (command.empty() || command == "metrics")
+        return render_metrics();
+    if (command == "trace")
+        return trace::render_chrome_json();
+    if (command == "trace on")
+    {
+        trace::set_enabled(true);
+        return "Tracing enabled.\n";
+    }
+    if (command == "trace off")
+    {
+        trace::set_enabled(false);
+        return "Tracing disabled.\n";
+    }
+
+    std::string reply{"Unknown admin command: "};
+    reply += command;
+    reply += '\n';
+    return reply;
+}
+
+void admin_socket_function(int admin_fd)
+{
+    while (true)
+    {
+        int fd{socket_process::accept(admin_fd, nullptr, nullptr)};
+        if (fd < 0)
+        {
+            if (!recover_from_accept_error())
+                return;
+            continue;
+        }
+
+        std::string text{run_admin_command(read_admin_command(fd))};
+        bool make_gcc_happy [[maybe_unused]]{
+            file_process::write(fd, text.data(), text.size()) == text.size()};
+        file_process::close(fd);
+    }
+}
+
+template <typename F>
+[[nodiscard]] static bool measured(METRIC_OP op, F &&handler)
+{
+    trace::span request_span{metrics::op_name(op)};
+    auto start{std::chrono::steady_clock::now()};
+    bool is_ok{handler()};
+    metrics::record(op,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count(),
+                    is_ok);
+    return is_ok;
+}
+
 void ftp_server_open_connection_function(int fd_to_client)
 {
     myftp_head myftp_head_buf;
@@ -90,20 +271,26 @@ void ftp_server_open_connection_function(int fd_to_client)
         file_process::close(fd_to_client);
         return;
     }
-    if (!open_connection(fd_to_client))
+    if (!measured(METRIC_OP::OPEN,
+                  [&]
+                  {
+                      TRACE_SPAN("accept");
+                      return open_connection(fd_to_client);
+                  }))
     {
         file_process::close(fd_to_client);
         return;
     }
 
+    metrics::session_opened();
     ftp_server_main_process_function(fd_to_client);
+    metrics::session_closed();
     file_process::close(fd_to_client);
 }
 
 void ftp_server_main_process_function(int fd_to_client)
 {
     myftp_head myftp_head_buf;
-    char file_buf[BUF_SIZE];
 
     bool is_connected{false};
 
@@ -112,22 +299,92 @@ void ftp_server_main_process_function(int fd_to_client)
         if (!myftp_head_buf.get(fd_to_client))
             return;
 
-        switch (myftp_head_buf.get_type())
+        myftp_head_view head;
+        {
+            TRACE_SPAN("parse");
+            head = myftp_head_buf.parse();
+        }
+
+        // Request payloads are capped at BUF_SIZE by the head rules and
+        // --io-buffer is at least that large, so a pooled buffer holds any
+        // of them.
+        buffer_pool::lease request_buf{io_buffer_pool->acquire()};
+        if (!request_buf.is_valid())
+            return;
+        char *file_buf{request_buf.data()};
+
+        switch (head.type)
         {
         case MYFTP_HEAD_TYPE::LIST_REQUEST:
-            is_connected = list(fd_to_client, file_buf);
+            is_connected = measured(METRIC_OP::LIST,
+                                    [&] { return list(fd_to_client, file_buf); });
+            break;
+        case MYFTP_HEAD_TYPE::META_LIST_REQUEST:
+            is_connected = measured(
+                METRIC_OP::LIST,
+                [&]
+                {
+                    return meta_list(fd_to_client, file_buf,
+                                     head.payload_length(), head.status);
+                });
             break;
         case MYFTP_HEAD_TYPE::GET_REQUEST:
-            is_connected = download_file(fd_to_client, file_buf,
-                                         myftp_head_buf.get_payload_length());
+            is_connected = measured(
+                METRIC_OP::GET,
+                [&]
+                {
+                    return download_file(fd_to_client, file_buf,
+                                         head.payload_length(), head.status);
+                });
             break;
         case MYFTP_HEAD_TYPE::PUT_REQUEST:
-            is_connected = upload_file(fd_to_client, file_buf,
-                                       myftp_head_buf.get_payload_length());
+            is_connected = measured(
+                METRIC_OP::PUT,
+                [&]
+                {
+                    return upload_file(fd_to_client, file_buf,
+                                       head.payload_length(), head.status);
+                });
             break;
         case MYFTP_HEAD_TYPE::SHA_REQUEST:
-            is_connected = sha256(fd_to_client, file_buf,
-                                  myftp_head_buf.get_payload_length());
+            is_connected = measured(
+                METRIC_OP::SHA,
+                [&]
+                {
+                    return sha256(fd_to_client, file_buf,
+                                  head.payload_length(), head.status);
+                });
+            break;
+        case MYFTP_HEAD_TYPE::SHA_BATCH_REQUEST:
+            is_connected = measured(
+                METRIC_OP::SHA,
+                [&]
+                { return sha256_batch(fd_to_client, head.payload_length()); });
+            break;
+        case MYFTP_HEAD_TYPE::DELETE_REQUEST:
+            is_connected = measured(
+                METRIC_OP::DELETE,
+                [&]
+                {
+                    return delete_file(fd_to_client, file_buf,
+                                       head.payload_length());
+                });
+            break;
+        case MYFTP_HEAD_TYPE::COPY_REQUEST:
+        case MYFTP_HEAD_TYPE::MOVE_REQUEST:
+        {
+            bool is_move{head.type == MYFTP_HEAD_TYPE::MOVE_REQUEST};
+            is_connected = measured(
+                is_move ? METRIC_OP::MOVE : METRIC_OP::COPY,
+                [&]
+                {
+                    return copy_or_move_file(fd_to_client, file_buf,
+                                             head.payload_length(), is_move);
+                });
+            break;
+        }
+        case MYFTP_HEAD_TYPE::STATS_REQUEST:
+            is_connected = stats(fd_to_client);
             break;
         case MYFTP_HEAD_TYPE::QUIT_REQUEST:
             is_connected = quit_connection(fd_to_client);
@@ -149,57 +406,250 @@ void ftp_server_main_process_function(int fd_to_client)
 }
 
 [[nodiscard]] bool upload_file(int fd_to_client, char *buf,
-                               std::uint32_t file_name_length)
+                               std::uint32_t file_name_length,
+                               std::uint8_t flags)
 {
     if (file_process::read(fd_to_client, buf, file_name_length) !=
         file_name_length)
         return false;
-    std::string_view path{buf, file_name_length - 1};
+    std::string path{buf, file_name_length - 1};
 
-    if (!PUT_REPLY.send(fd_to_client))
-        return false;
+    {
+        TRACE_SPAN("reply");
+        if (!(flags & MYFTP_FLAG_SPARSE ? PUT_REPLY_SPARSE : PUT_REPLY)
+                 .send(fd_to_client))
+            return false;
+    }
 
     myftp_head tmp_head;
-    if (!tmp_head.get(fd_to_client) ||
-        tmp_head.get_type() != MYFTP_HEAD_TYPE::FILE_DATA)
+    if (!tmp_head.get(fd_to_client))
+        return false;
+
+    myftp_head_view file_data{tmp_head.parse()};
+    if (file_data.type != MYFTP_HEAD_TYPE::FILE_DATA &&
+        file_data.type != MYFTP_HEAD_TYPE::SPARSE_DATA)
         return false;
 
-    std::size_t file_size{tmp_head.get_payload_length()};
+    std::size_t file_size{file_data.payload_length()};
+    metrics::add_bytes_received(file_size);
+
+    if (content_cache)
+        content_cache->invalidate(path);
+
+    sha256_hasher hasher;
+    sha256_hasher *digest{flags & MYFTP_FLAG_DIGEST_TRAILER ? &hasher
+                                                            : nullptr};
 
-    if (!receive_file(fd_to_client, path.data(), buf, file_size))
+    bool is_received;
+    if (file_data.type == MYFTP_HEAD_TYPE::SPARSE_DATA)
+    {
+        buffer_pool::lease io_buf{io_buffer_pool->acquire()};
+        is_received = io_buf.is_valid() &&
+                      receive_sparse_file(fd_to_client, path.c_str(),
+                                          io_buf.data(), file_size, digest,
+                                          io_buf.size());
+    }
+    else if (config.direct_io.enabled)
+        is_received = receive_file_direct(fd_to_client, path.c_str(),
+                                          file_size, *io_buffer_pool,
+                                          config.direct_io, digest);
+    else
+    {
+        buffer_pool::lease io_buf{io_buffer_pool->acquire()};
+        is_received = io_buf.is_valid() &&
+                      receive_file(fd_to_client, path.c_str(), io_buf.data(),
+                                   file_size, digest, io_buf.size());
+    }
+
+    // A GET racing the upload may have cached old or partial content whose
+    // size and mtime still match the finished file.
+    if (content_cache)
+        content_cache->invalidate(path);
+    if (!is_received)
         return false;
 
-    return true;
+    if (!digest)
+        return true;
+
+    bool is_matched;
+    if (!receive_digest_trailer(fd_to_client, hasher.finish(), is_matched))
+        return false;
+    if (std::error_code ec; !is_matched)
+        std::filesystem::remove(path, ec);
+
+    return (is_matched ? PUT_REPLY : PUT_REPLY_FAIL).send(fd_to_client);
+}
+
+[[nodiscard]] bool delete_file(int fd_to_client, char *buf,
+                               std::uint32_t file_name_length)
+{
+    if (file_name_length == 0 || file_name_length > BUF_SIZE ||
+        file_process::read(fd_to_client, buf, file_name_length) !=
+            file_name_length)
+        return false;
+    std::string path{buf, file_name_length - 1};
+
+    struct stat file_stat;
+    bool is_removed{::lstat(path.c_str(), &file_stat) == 0 &&
+                    S_ISREG(file_stat.st_mode) && ::unlink(path.c_str()) == 0};
+    if (is_removed && content_cache)
+        content_cache->invalidate(path);
+
+    return (is_removed ? DELETE_REPLY_SUCCESS : DELETE_REPLY_FAIL)
+        .send(fd_to_client);
+}
+
+[[nodiscard]] bool copy_or_move_file(int fd_to_client, char *buf,
+                                     std::uint32_t payload_length,
+                                     bool is_move)
+{
+    if (file_process::read(fd_to_client, buf, payload_length) !=
+        payload_length)
+        return false;
+
+    std::string_view payload{buf, payload_length};
+    std::size_t separator{payload.find('\0')};
+    bool is_done{separator + 1 < payload.size() && payload.back() == '\0' &&
+                 payload.find('\0', separator + 1) == payload.size() - 1};
+
+    if (is_done)
+    {
+        std::string source{payload.substr(0, separator)};
+        std::string target{payload.substr(separator + 1,
+                                          payload.size() - separator - 2)};
+
+        buffer_pool::lease io_buf{io_buffer_pool->acquire()};
+        COPY_METHOD method;
+        is_done = io_buf.is_valid() &&
+                  (is_move ? move_file(source.c_str(), target.c_str(),
+                                       io_buf.data(), io_buf.size(), method)
+                           : copy_file(source.c_str(), target.c_str(),
+                                       io_buf.data(), io_buf.size(), method));
+        if (is_done)
+            metrics::copy_method_used(method);
+
+        if (is_done && content_cache)
+        {
+            content_cache->invalidate(target);
+            if (is_move)
+                content_cache->invalidate(source);
+        }
+    }
+
+    if (is_move)
+        return (is_done ? MOVE_REPLY_SUCCESS : MOVE_REPLY_FAIL)
+            .send(fd_to_client);
+    return (is_done ? COPY_REPLY_SUCCESS : COPY_REPLY_FAIL).send(fd_to_client);
 }
 
 [[nodiscard]] bool download_file(int fd_to_client, char *buf,
-                                 std::uint32_t file_name_length)
+                                 std::uint32_t file_name_length,
+                                 std::uint8_t flags)
 {
     if (file_process::read(fd_to_client, buf, file_name_length) !=
         file_name_length)
         return false;
     std::string_view path{buf, file_name_length - 1};
-    if (!std::filesystem::is_regular_file(path))
+
+    struct stat file_stat;
+    bool is_found;
     {
+        TRACE_SPAN("resolve");
+        is_found = ::stat(path.data(), &file_stat) == 0 &&
+                   S_ISREG(file_stat.st_mode);
+    }
+    if (!is_found)
+    {
+        TRACE_SPAN("reply");
         if (!GET_REPLY_FAIL.send(fd_to_client))
             return false;
     }
-    else
+    else if (content_cache && content_cache->is_cacheable(file_stat))
     {
-        if (!GET_REPLY_SUCCESS.send(fd_to_client))
+        std::string path_str{path};
+        auto cached{content_cache->lookup(path_str, file_stat)};
+        if (!cached)
+        {
+            TRACE_SPAN("disk_read");
+            cached = content_cache->load(path_str, file_stat);
+        }
+        if (!cached)
+            return send_uncached_file(fd_to_client, path, file_stat, flags);
+
+        myftp_head file_data(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                             MYFTP_HEAD_SIZE + cached->data.size());
+        myftp_digest_trailer trailer;
+        iovec iov[]{
+            {const_cast<myftp_head *>(&GET_REPLY_SUCCESS), MYFTP_HEAD_SIZE},
+            {&file_data, MYFTP_HEAD_SIZE},
+            {const_cast<char *>(cached->data.data()), cached->data.size()},
+            {&trailer, MYFTP_DIGEST_TRAILER_SIZE}};
+        std::size_t total_size{2 * MYFTP_HEAD_SIZE + cached->data.size()};
+        int iov_count{3};
+
+        if (flags & MYFTP_FLAG_DIGEST_TRAILER)
+        {
+            trailer = myftp_digest_trailer{cached->get_digest()};
+            total_size += MYFTP_DIGEST_TRAILER_SIZE;
+            ++iov_count;
+        }
+
+        TRACE_SPAN("net_write");
+        if (file_process::writev(fd_to_client, iov, iov_count) != total_size)
             return false;
+        metrics::add_bytes_sent(cached->data.size());
+    }
+    else if (!send_uncached_file(fd_to_client, path, file_stat, flags))
+        return false;
+    return true;
+}
 
-        std::size_t file_size{std::filesystem::file_size(path)};
+[[nodiscard]] bool send_uncached_file(int fd_to_client, std::string_view path,
+                                      const struct stat &file_stat,
+                                      std::uint8_t flags)
+{
+    std::size_t file_size{static_cast<std::size_t>(file_stat.st_size)};
 
-        myftp_head get_reply(MYFTP_HEAD_TYPE::FILE_DATA, 1,
-                             MYFTP_HEAD_SIZE + file_size);
+    sha256_hasher hasher;
+    sha256_hasher *digest{flags & MYFTP_FLAG_DIGEST_TRAILER ? &hasher
+                                                            : nullptr};
 
-        if (!get_reply.send(fd_to_client))
-            return false;
+    buffer_pool::lease io_buf{io_buffer_pool->acquire()};
+    if (!io_buf.is_valid())
+        return false;
+
+    bool is_sparse_reply{(flags & MYFTP_FLAG_SPARSE) && is_sparse(file_stat)};
+    file_descriptor file{
+        is_sparse_reply ? ::open(path.data(), O_RDONLY | O_CLOEXEC) : -1};
+    sparse_map map;
 
-        if (!send_file(fd_to_client, path.data(), buf, file_size))
+    if (file.is_valid() && map_data_extents(file.get(), file_size, map))
+    {
+        if (!GET_REPLY_SUCCESS.send(fd_to_client) ||
+            !send_sparse_file(fd_to_client, file.get(), map, io_buf.data(),
+                              digest, io_buf.size()))
             return false;
+        metrics::add_bytes_sent(map.data_size());
     }
+    else
+    {
+        myftp_head get_reply(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                             MYFTP_HEAD_SIZE + file_size);
+        bool is_replied;
+        {
+            TRACE_SPAN("reply");
+            is_replied = GET_REPLY_SUCCESS.send(fd_to_client) &&
+                         get_reply.send(fd_to_client);
+        }
+        if (!is_replied ||
+            !send_file(fd_to_client, path.data(), io_buf.data(), file_size,
+                       config.read_hint, digest, io_buf.size()))
+            return false;
+        metrics::add_bytes_sent(file_size);
+    }
+
+    if (digest && !myftp_digest_trailer{hasher.finish()}.send(fd_to_client))
+        return false;
     return true;
 }
 
@@ -233,49 +683,227 @@ void ftp_server_main_process_function(int fd_to_client)
     return true;
 }
 
+static bool collect_file_meta(std::string_view prefix, bool recursive,
+                              std::vector<file_meta> &records)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it{
+        ".", fs::directory_options::skip_permission_denied, ec};
+    for (; !ec && it != fs::recursive_directory_iterator{}; it.increment(ec))
+    {
+        std::string path{it->path().string()};
+        std::string_view name{std::string_view{path}.substr(2)};
+
+        struct stat file_stat;
+        if (::lstat(path.c_str(), &file_stat) != 0 ||
+            name.size() > UINT16_MAX)
+        {
+            it.disable_recursion_pending();
+            continue;
+        }
+
+        if (S_ISDIR(file_stat.st_mode) &&
+            (!recursive || !(name.starts_with(prefix) ||
+                             prefix.starts_with(std::string{name} + '/'))))
+            it.disable_recursion_pending();
+
+        if (!name.starts_with(prefix))
+            continue;
+
+        file_meta meta{std::string{name},
+                       static_cast<std::uint64_t>(file_stat.st_size),
+                       static_cast<std::int64_t>(file_stat.st_mtim.tv_sec) *
+                               1000000000 +
+                           file_stat.st_mtim.tv_nsec,
+                       file_stat.st_mode,
+                       std::nullopt};
+        if (content_cache && S_ISREG(file_stat.st_mode))
+            if (auto cached{content_cache->peek(meta.name, file_stat)})
+                meta.digest = cached->get_digest();
+        records.push_back(std::move(meta));
+    }
+
+    std::sort(records.begin(), records.end(),
+              [](const file_meta &a, const file_meta &b)
+              { return a.name < b.name; });
+    return !ec;
+}
+
+[[nodiscard]] bool meta_list(int fd_to_client, char *buf,
+                             std::uint32_t prefix_length, std::uint8_t flags)
+{
+    if (file_process::read(fd_to_client, buf, prefix_length) != prefix_length)
+        return false;
+    std::string_view prefix{buf, prefix_length - 1};
+
+    std::vector<file_meta> records;
+    std::string payload;
+    bool is_ok{collect_file_meta(prefix, flags & MYFTP_FLAG_RECURSIVE,
+                                 records)};
+    for (const file_meta &meta : records)
+        append_file_meta(payload, meta);
+    if (payload.size() > UINT32_MAX - MYFTP_HEAD_SIZE)
+        is_ok = false;
+    if (!is_ok)
+        payload.clear();
+
+    myftp_head reply(MYFTP_HEAD_TYPE::META_LIST_REPLY, is_ok,
+                     MYFTP_HEAD_SIZE + payload.size());
+    iovec iov[]{{&reply, MYFTP_HEAD_SIZE},
+                {payload.data(), payload.size()}};
+    return file_process::writev(fd_to_client, iov, 2) ==
+           MYFTP_HEAD_SIZE + payload.size();
+}
+
 [[nodiscard]] bool sha256(int fd_to_client, char *buf,
-                          std::uint32_t file_name_length)
+                          std::uint32_t file_name_length, std::uint8_t flags)
 {
     if (file_process::read(fd_to_client, buf, file_name_length) !=
         file_name_length)
         return false;
 
-    std::string cmd{"sha256sum "};
-    cmd += buf;
+    if (flags & MYFTP_FLAG_MERKLE_TREE)
+        return merkle_sha256(fd_to_client, {buf, file_name_length - 1});
 
+    std::string_view name{buf, file_name_length - 1};
     std::string path{"./"};
-    path += buf;
+    path += name;
 
-    if (!std::filesystem::is_regular_file(path))
+    struct stat file_stat;
+    sha256_digest digest;
+    bool is_hashed{::stat(path.c_str(), &file_stat) == 0 &&
+                   S_ISREG(file_stat.st_mode)};
+    if (is_hashed)
     {
-        if (!SHA_REPLAY_FAIL.send(fd_to_client))
-            return false;
+        std::shared_ptr<const file_cache::entry> cached;
+        if (content_cache)
+            cached = content_cache->peek(std::string{name}, file_stat);
+
+        if (cached)
+            digest = cached->get_digest();
+        else
+        {
+            buffer_pool::lease io_buf{io_buffer_pool->acquire()};
+            is_hashed = io_buf.is_valid() &&
+                        sha256_file(path.c_str(), io_buf.data(),
+                                    io_buf.size(), digest);
+        }
     }
-    else
+    if (!is_hashed)
+        return SHA_REPLAY_FAIL.send(fd_to_client);
+
+    std::string reply{to_hex(digest)};
+    reply += "  ";
+    reply += name;
+    reply += '\n';
+
+    myftp_head sha_reply_head(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                              MYFTP_HEAD_SIZE + reply.size() + 1);
+    if (!SHA_REPLAY_SUCCESS.send(fd_to_client) ||
+        !sha_reply_head.send(fd_to_client))
+        return false;
+
+    return file_process::write(fd_to_client, reply.c_str(),
+                               reply.size() + 1) == reply.size() + 1;
+}
+
+[[nodiscard]] bool sha256_batch(int fd_to_client,
+                                std::uint32_t payload_length)
+{
+    std::string payload(payload_length, '\0');
+    if (file_process::read(fd_to_client, payload.data(), payload_length) !=
+        payload_length)
+        return false;
+    if (payload.back() != '\0')
+        return SHA_BATCH_REPLY_FAIL.send(fd_to_client);
+
+    std::vector<std::string_view> patterns;
+    for (std::size_t begin{0}; begin < payload.size();)
     {
-        FILE_ptr read_fp{popen(cmd.c_str(), "r")};
-        if (read_fp.is_valid())
+        std::size_t end{payload.find('\0', begin)};
+        patterns.emplace_back(payload.data() + begin, end - begin);
+        begin = end + 1;
+    }
+
+    if (!SHA_BATCH_REPLY_SUCCESS.send(fd_to_client))
+        return false;
+
+    bool is_sent{hash_files(
+        expand_hash_patterns(patterns), *hash_workers,
+        [fd_to_client](file_hash_result result)
         {
-            if (std::size_t read_num{
-                    fread(buf, sizeof(char), BUF_SIZE - 1, read_fp.get_ptr())};
-                read_num > 0)
-            {
-                buf[read_num] = 0;
+            std::size_t digest_size{result.digest ? SHA256_DIGEST_SIZE : 0};
+            myftp_head file_data(MYFTP_HEAD_TYPE::FILE_DATA,
+                                 result.digest.has_value(),
+                                 MYFTP_HEAD_SIZE + digest_size +
+                                     result.name.size());
+            iovec iov[]{{&file_data, MYFTP_HEAD_SIZE},
+                        {result.digest ? result.digest->data() : nullptr,
+                         digest_size},
+                        {result.name.data(), result.name.size()}};
+            return file_process::writev(fd_to_client, iov, 3) ==
+                   MYFTP_HEAD_SIZE + digest_size + result.name.size();
+        })};
+    return is_sent && SHA_BATCH_END.send(fd_to_client);
+}
 
-                if (!SHA_REPLAY_SUCCESS.send(fd_to_client))
-                    return false;
+[[nodiscard]] bool merkle_sha256(int fd_to_client, std::string_view path)
+{
+    // The reply carries one "<index> <hex digest>\n" line per leaf after a
+    // header holding the path, so bound the leaf count by the frame length.
+    constexpr std::uint64_t MAX_LEAF_LINE{20 + 1 + 2 * SHA256_DIGEST_SIZE + 1};
+    constexpr std::uint64_t MAX_LEAVES{
+        (UINT32_MAX - MYFTP_HEAD_SIZE - BUF_SIZE - 256) / MAX_LEAF_LINE};
+
+    struct stat file_stat;
+    merkle_tree tree;
+    if (::stat(path.data(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode) ||
+        (static_cast<std::uint64_t>(file_stat.st_size) +
+         config.merkle_leaf_size - 1) / config.merkle_leaf_size >
+            MAX_LEAVES ||
+        !compute_merkle_tree(path.data(), config.merkle_leaf_size,
+                             *hash_workers, tree))
+        return SHA_REPLAY_FAIL.send(fd_to_client);
+
+    std::string reply{to_hex(tree.root)};
+    reply += "  ";
+    reply += path;
+    reply += "\nleaf_size ";
+    reply += std::to_string(tree.leaf_size);
+    reply += "\nfile_size ";
+    reply += std::to_string(tree.file_size);
+    reply += "\nleaves ";
+    reply += std::to_string(tree.leaves.size());
+    reply += '\n';
+    for (std::size_t i{0}; i < tree.leaves.size(); ++i)
+    {
+        reply += std::to_string(i);
+        reply += ' ';
+        reply += to_hex(tree.leaves[i]);
+        reply += '\n';
+    }
 
-                myftp_head sha_reply_head(MYFTP_HEAD_TYPE::FILE_DATA, 1,
-                                          MYFTP_HEAD_SIZE + read_num + 1);
+    myftp_head sha_reply_head(MYFTP_HEAD_TYPE::FILE_DATA, 1,
+                              MYFTP_HEAD_SIZE + reply.size() + 1);
+    if (!SHA_REPLAY_SUCCESS.send(fd_to_client) ||
+        !sha_reply_head.send(fd_to_client))
+        return false;
 
-                if (!sha_reply_head.send(fd_to_client))
-                    return false;
+    return file_process::write(fd_to_client, reply.c_str(),
+                               reply.size() + 1) == reply.size() + 1;
+}
 
-                if (file_process::write(fd_to_client, buf, read_num + 1) !=
-                    read_num + 1)
-                    return false;
-            }
-        }
-    }
-    return true;
+[[nodiscard]] bool stats(int fd_to_client)
+{
+    std::string text{render_metrics()};
+
+    myftp_head stats_reply(MYFTP_HEAD_TYPE::STATS_REPLY, 1,
+                           MYFTP_HEAD_SIZE + text.size() + 1);
+    if (!stats_reply.send(fd_to_client))
+        return false;
+
+    return file_process::write(fd_to_client, text.c_str(), text.size() + 1) ==
+           text.size() + 1;
 }
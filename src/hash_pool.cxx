@@ -0,0 +1,47 @@
+#include "hash_pool.hxx"
+#include <algorithm>
+
+hash_pool::hash_pool(unsigned n_threads, buffer_pool &buffers)
+    : m_buffers{buffers}
+{
+    for (unsigned i{0}; i < std::max(1u, n_threads); ++i)
+        m_threads.emplace_back(&hash_pool::worker, this);
+}
+
+hash_pool::~hash_pool()
+{
+    {
+        std::lock_guard lock{m_mutex};
+        m_is_stopping = true;
+    }
+    m_is_ready.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void hash_pool::worker()
+{
+    for (;;)
+    {
+        std::unique_lock lock{m_mutex};
+        m_is_ready.wait(lock,
+                        [this] { return m_is_stopping || !m_tasks.empty(); });
+        if (m_tasks.empty())
+            return;
+        task work{std::move(m_tasks.front())};
+        m_tasks.pop_front();
+        lock.unlock();
+
+        buffer_pool::lease buf{m_buffers.acquire()};
+        work(buf.data(), buf.size());
+    }
+}
+
+void hash_pool::submit(task work)
+{
+    {
+        std::lock_guard lock{m_mutex};
+        m_tasks.push_back(std::move(work));
+    }
+    m_is_ready.notify_one();
+}
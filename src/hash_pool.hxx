@@ -0,0 +1,42 @@
+#ifndef HASH_POOL_HXX
+#define HASH_POOL_HXX
+
+#include "buffer_pool.hxx"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of hashing threads shared by every session. Each task runs
+// with a buffer leased from `buffers`, or with a null buffer when the pool
+// is exhausted, so tasks must report that as a failure.
+class hash_pool
+{
+public:
+    using task = std::function<void(char *buf, std::size_t buf_size)>;
+
+private:
+    buffer_pool &m_buffers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_is_ready;
+    std::deque<task> m_tasks;
+    bool m_is_stopping = false;
+
+    std::vector<std::thread> m_threads;
+
+    void worker();
+
+public:
+    hash_pool(unsigned n_threads, buffer_pool &buffers);
+    hash_pool(const hash_pool &) = delete;
+    hash_pool &operator=(const hash_pool &) = delete;
+    ~hash_pool();
+
+    void submit(task work);
+};
+
+#endif
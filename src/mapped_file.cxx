@@ -0,0 +1,72 @@
+#include "mapped_file.hxx"
+#include "file_process.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const std::size_t PAGE_SIZE{
+    static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))};
+
+mapped_file::mapped_file(const char *path, std::size_t size)
+{
+    if (size == 0)
+        return;
+
+    m_fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+        return;
+
+    void *ptr{::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0)};
+    if (ptr == MAP_FAILED)
+        return;
+
+    m_data = static_cast<char *>(ptr);
+    m_size = size;
+}
+
+mapped_file::~mapped_file()
+{
+    if (m_data)
+        ::munmap(m_data, m_size);
+    if (m_fd >= 0)
+        file_process::close(m_fd);
+}
+
+bool mapped_file::is_valid() const { return m_data != nullptr; }
+const char *mapped_file::data() const { return m_data; }
+std::size_t mapped_file::size() const { return m_size; }
+
+bool mapped_file::is_truncated_before(std::size_t end) const
+{
+    struct stat file_stat;
+    return ::fstat(m_fd, &file_stat) != 0 ||
+           static_cast<std::size_t>(file_stat.st_size) < end;
+}
+
+void mapped_file::advise_sequential()
+{
+    ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+    ::posix_fadvise(m_fd, 0, m_size, POSIX_FADV_SEQUENTIAL);
+}
+
+void mapped_file::will_need(std::size_t offset, std::size_t length)
+{
+    if (offset >= m_size)
+        return;
+    ::posix_fadvise(m_fd, offset, std::min(length, m_size - offset),
+                    POSIX_FADV_WILLNEED);
+}
+
+void mapped_file::dont_need(std::size_t offset, std::size_t length)
+{
+    std::size_t begin{offset / PAGE_SIZE * PAGE_SIZE};
+    std::size_t end{std::min(offset + length, m_size)};
+    if (begin >= end)
+        return;
+
+    ::madvise(m_data + begin, end - begin, MADV_DONTNEED);
+    ::posix_fadvise(m_fd, begin, end - begin, POSIX_FADV_DONTNEED);
+}
@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_HXX
+#define MAPPED_FILE_HXX
+
+#include <cstddef>
+
+class mapped_file
+{
+private:
+    int m_fd = -1;
+    char *m_data = nullptr;
+    std::size_t m_size = 0;
+
+public:
+    mapped_file(const char *path, std::size_t size);
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file();
+
+    bool is_valid() const;
+    const char *data() const;
+    std::size_t size() const;
+    bool is_truncated_before(std::size_t end) const;
+
+    void advise_sequential();
+    void will_need(std::size_t offset, std::size_t length);
+    void dont_need(std::size_t offset, std::size_t length);
+};
+
+#endif
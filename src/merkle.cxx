@@ -0,0 +1,119 @@
+#include "merkle.hxx"
+#include "file_process.hxx"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr std::uint8_t LEAF_PREFIX{0x00};
+constexpr std::uint8_t NODE_PREFIX{0x01};
+
+[[nodiscard]] static bool read_at(int fd, char *buf, std::size_t size,
+                                  off_t offset)
+{
+    std::size_t n_read_bytes{0};
+    while (n_read_bytes != size)
+    {
+        ssize_t n_read{::pread(fd, buf + n_read_bytes, size - n_read_bytes,
+                               offset + n_read_bytes)};
+        if (n_read < 0 && errno == EINTR)
+            continue;
+        if (n_read <= 0)
+            return false;
+        n_read_bytes += n_read;
+    }
+    return true;
+}
+
+static sha256_digest hash_node(const sha256_digest &left,
+                               const sha256_digest &right)
+{
+    sha256_hasher hasher;
+    hasher.update(&NODE_PREFIX, 1);
+    hasher.update(left.data(), left.size());
+    hasher.update(right.data(), right.size());
+    return hasher.finish();
+}
+
+static sha256_digest reduce(std::vector<sha256_digest> level)
+{
+    while (level.size() > 1)
+    {
+        std::size_t n_parents{(level.size() + 1) / 2};
+        for (std::size_t i{0}; i < n_parents; ++i)
+            level[i] = 2 * i + 1 < level.size()
+                           ? hash_node(level[2 * i], level[2 * i + 1])
+                           : level[2 * i];
+        level.resize(n_parents);
+    }
+    return level.front();
+}
+
+[[nodiscard]] bool compute_merkle_tree(const char *path, std::size_t leaf_size,
+                                       hash_pool &pool, merkle_tree &tree)
+{
+    int fd{::open(path, O_RDONLY | O_CLOEXEC)};
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0 || leaf_size == 0)
+    {
+        file_process::close(fd);
+        return false;
+    }
+
+    tree.leaf_size = leaf_size;
+    tree.file_size = file_stat.st_size;
+    std::size_t n_leaves{std::max<std::size_t>(
+        1, (tree.file_size + leaf_size - 1) / leaf_size)};
+    tree.leaves.assign(n_leaves, {});
+
+    std::mutex mutex;
+    std::condition_variable is_done;
+    std::size_t n_pending{n_leaves};
+    std::atomic<bool> is_ok{true};
+
+    for (std::size_t i{0}; i < n_leaves; ++i)
+        pool.submit(
+            [&, i](char *buf, std::size_t buf_size)
+            {
+                std::uint64_t offset{i * leaf_size};
+                std::uint64_t end{std::min<std::uint64_t>(
+                    offset + leaf_size, tree.file_size)};
+
+                sha256_hasher hasher;
+                hasher.update(&LEAF_PREFIX, 1);
+                for (; is_ok && offset < end; offset += buf_size)
+                {
+                    std::size_t length{static_cast<std::size_t>(
+                        std::min<std::uint64_t>(buf_size, end - offset))};
+                    if (!buf || !read_at(fd, buf, length, offset))
+                        is_ok = false;
+                    else
+                        hasher.update(buf, length);
+                }
+                if (is_ok)
+                    tree.leaves[i] = hasher.finish();
+
+                std::lock_guard lock{mutex};
+                --n_pending;
+                is_done.notify_one();
+            });
+
+    {
+        std::unique_lock lock{mutex};
+        is_done.wait(lock, [&] { return n_pending == 0; });
+    }
+
+    file_process::close(fd);
+    if (!is_ok)
+        return false;
+
+    tree.root = reduce(tree.leaves);
+    return true;
+}
@@ -0,0 +1,21 @@
+#ifndef MERKLE_HXX
+#define MERKLE_HXX
+
+#include "hash_pool.hxx"
+#include "sha256.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct merkle_tree
+{
+    std::size_t leaf_size;
+    std::uint64_t file_size;
+    std::vector<sha256_digest> leaves;
+    sha256_digest root;
+};
+
+[[nodiscard]] bool compute_merkle_tree(const char *path, std::size_t leaf_size,
+                                       hash_pool &pool, merkle_tree &tree);
+
+#endif
@@ -0,0 +1,319 @@
+#include "metrics.hxx"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+constexpr std::size_t N_OPS{static_cast<std::size_t>(METRIC_OP::COUNT)};
+constexpr std::array<std::string_view, N_OPS> OP_NAMES{
+    "open", "list", "get", "put", "sha", "delete", "copy", "move"};
+
+constexpr std::size_t N_COPY_METHODS{
+    static_cast<std::size_t>(COPY_METHOD::RENAME) + 1};
+constexpr std::array<std::string_view, N_COPY_METHODS> COPY_METHOD_NAMES{
+    "clone", "copy_range", "buffered", "rename"};
+
+constexpr int SUB_BUCKET_BITS{3};
+constexpr std::size_t SUB_BUCKETS{1 << SUB_BUCKET_BITS};
+constexpr std::size_t N_BUCKETS{(64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS};
+
+constexpr int EXPORTED_MIN_EXPONENT{10};
+constexpr int EXPORTED_MAX_EXPONENT{36};
+
+static constexpr std::size_t bucket_of(std::uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return value;
+    int exponent{static_cast<int>(std::bit_width(value)) - 1};
+    std::size_t sub{(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1)};
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+static constexpr std::uint64_t bucket_upper_bound(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket + 1;
+    int exponent{static_cast<int>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1};
+    std::uint64_t sub{bucket % SUB_BUCKETS};
+    return (SUB_BUCKETS + sub + 1) << (exponent - SUB_BUCKET_BITS);
+}
+
+static_assert(bucket_of(7) == 7 && bucket_of(8) == 8 && bucket_of(15) == 15);
+static_assert(bucket_of(16) == 16 && bucket_upper_bound(16) == 18);
+static_assert(bucket_upper_bound(bucket_of(1 << 20)) > (1 << 20));
+
+struct op_counters
+{
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> errors;
+    std::atomic<std::uint64_t> latency_sum_ns;
+    std::array<std::atomic<std::uint64_t>, N_BUCKETS> histogram;
+};
+
+struct shard
+{
+    std::array<op_counters, N_OPS> ops;
+    std::array<std::atomic<std::uint64_t>, N_COPY_METHODS> copy_methods;
+    std::atomic<std::uint64_t> bytes_sent;
+    std::atomic<std::uint64_t> bytes_received;
+};
+
+static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t delta)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+}
+
+static void merge(shard &to, const shard &from)
+{
+    auto add{[](std::atomic<std::uint64_t> &counter,
+                const std::atomic<std::uint64_t> &delta)
+             {
+                 counter.fetch_add(delta.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+             }};
+
+    for (std::size_t op{0}; op < N_OPS; ++op)
+    {
+        add(to.ops[op].count, from.ops[op].count);
+        add(to.ops[op].errors, from.ops[op].errors);
+        add(to.ops[op].latency_sum_ns, from.ops[op].latency_sum_ns);
+        for (std::size_t i{0}; i < N_BUCKETS; ++i)
+            add(to.ops[op].histogram[i], from.ops[op].histogram[i]);
+    }
+    for (std::size_t i{0}; i < N_COPY_METHODS; ++i)
+        add(to.copy_methods[i], from.copy_methods[i]);
+    add(to.bytes_sent, from.bytes_sent);
+    add(to.bytes_received, from.bytes_received);
+}
+
+class registry
+{
+private:
+    std::mutex m_mutex;
+    std::unordered_set<shard *> m_live;
+    shard m_retired{};
+
+public:
+    void attach(shard *s)
+    {
+        std::lock_guard lock{m_mutex};
+        m_live.insert(s);
+    }
+
+    void detach(shard *s)
+    {
+        std::lock_guard lock{m_mutex};
+        merge(m_retired, *s);
+        m_live.erase(s);
+    }
+
+    void snapshot(shard &total)
+    {
+        std::lock_guard lock{m_mutex};
+        merge(total, m_retired);
+        for (shard *s : m_live)
+            merge(total, *s);
+    }
+};
+
+static registry shards;
+static std::atomic<std::int64_t> active_sessions{0};
+static std::atomic<std::uint64_t> total_sessions{0};
+static const auto start_time{std::chrono::steady_clock::now()};
+
+class thread_shard
+{
+private:
+    std::unique_ptr<shard> m_shard{std::make_unique<shard>()};
+
+public:
+    thread_shard() { shards.attach(m_shard.get()); }
+    ~thread_shard() { shards.detach(m_shard.get()); }
+    shard &get() { return *m_shard; }
+};
+
+static shard &local_shard()
+{
+    thread_local thread_shard instance;
+    return instance.get();
+}
+
+static std::uint64_t quantile(const op_counters &counters, double q)
+{
+    std::uint64_t count{counters.count.load(std::memory_order_relaxed)};
+    if (count == 0)
+        return 0;
+
+    std::uint64_t rank{std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(q * count + 0.5))};
+    std::uint64_t seen{0};
+    for (std::size_t i{0}; i < N_BUCKETS; ++i)
+    {
+        seen += counters.histogram[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return bucket_upper_bound(i);
+    }
+    return bucket_upper_bound(N_BUCKETS - 1);
+}
+
+static void append(std::string &out, const char *format, auto... args)
+{
+    char line[256];
+    int n{std::snprintf(line, sizeof(line), format, args...)};
+    out.append(line, std::min<std::size_t>(n, sizeof(line) - 1));
+}
+
+namespace metrics
+{
+    void record(METRIC_OP op, std::uint64_t latency_ns, bool is_ok)
+    {
+        op_counters &counters{local_shard().ops[static_cast<std::size_t>(op)]};
+        bump(counters.count, 1);
+        bump(counters.latency_sum_ns, latency_ns);
+        bump(counters.histogram[bucket_of(latency_ns)], 1);
+        if (!is_ok)
+            bump(counters.errors, 1);
+    }
+
+    void add_bytes_sent(std::uint64_t bytes)
+    {
+        bump(local_shard().bytes_sent, bytes);
+    }
+
+    void add_bytes_received(std::uint64_t bytes)
+    {
+        bump(local_shard().bytes_received, bytes);
+    }
+
+    void copy_method_used(COPY_METHOD method)
+    {
+        bump(local_shard().copy_methods[static_cast<std::size_t>(method)], 1);
+    }
+
+    void session_opened()
+    {
+        active_sessions.fetch_add(1, std::memory_order_relaxed);
+        total_sessions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void session_closed()
+    {
+        active_sessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    const char *op_name(METRIC_OP op)
+    {
+        return OP_NAMES[static_cast<std::size_t>(op)].data();
+    }
+
+    std::string render_prometheus(const file_cache::statistics *cache)
+    {
+        auto total{std::make_unique<shard>()};
+        shards.snapshot(*total);
+
+        std::string out;
+        double uptime{std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start_time)
+                          .count()};
+
+        out += "# TYPE myftp_uptime_seconds gauge\n";
+        append(out, "myftp_uptime_seconds %.3f\n", uptime);
+        out += "# TYPE myftp_active_sessions gauge\n";
+        append(out, "myftp_active_sessions %lld\n",
+               static_cast<long long>(active_sessions.load()));
+        out += "# TYPE myftp_sessions_total counter\n";
+        append(out, "myftp_sessions_total %llu\n",
+               static_cast<unsigned long long>(total_sessions.load()));
+        out += "# TYPE myftp_bytes_sent_total counter\n";
+        append(out, "myftp_bytes_sent_total %llu\n",
+               static_cast<unsigned long long>(total->bytes_sent.load()));
+        out += "# TYPE myftp_bytes_received_total counter\n";
+        append(out, "myftp_bytes_received_total %llu\n",
+               static_cast<unsigned long long>(total->bytes_received.load()));
+
+        out += "# TYPE myftp_request_errors_total counter\n";
+        for (std::size_t op{0}; op < N_OPS; ++op)
+            append(out, "myftp_request_errors_total{op=\"%s\"} %llu\n",
+                   OP_NAMES[op].data(),
+                   static_cast<unsigned long long>(
+                       total->ops[op].errors.load()));
+
+        out += "# TYPE myftp_copy_method_total counter\n";
+        for (std::size_t i{0}; i < N_COPY_METHODS; ++i)
+            append(out, "myftp_copy_method_total{method=\"%s\"} %llu\n",
+                   COPY_METHOD_NAMES[i].data(),
+                   static_cast<unsigned long long>(
+                       total->copy_methods[i].load()));
+
+        out += "# TYPE myftp_request_duration_seconds histogram\n";
+        for (std::size_t op{0}; op < N_OPS; ++op)
+        {
+            const op_counters &counters{total->ops[op]};
+            const char *name{OP_NAMES[op].data()};
+
+            std::uint64_t cumulative{0};
+            std::size_t bucket{0};
+            for (int exponent{EXPORTED_MIN_EXPONENT};
+                 exponent <= EXPORTED_MAX_EXPONENT; ++exponent)
+            {
+                std::uint64_t bound{std::uint64_t{1} << exponent};
+                for (; bucket < N_BUCKETS && bucket_upper_bound(bucket) <= bound;
+                     ++bucket)
+                    cumulative += counters.histogram[bucket].load();
+                append(out,
+                       "myftp_request_duration_seconds_bucket{op=\"%s\","
+                       "le=\"%.9g\"} %llu\n",
+                       name, bound * 1e-9,
+                       static_cast<unsigned long long>(cumulative));
+            }
+            append(out,
+                   "myftp_request_duration_seconds_bucket{op=\"%s\","
+                   "le=\"+Inf\"} %llu\n",
+                   name, static_cast<unsigned long long>(counters.count.load()));
+            append(out, "myftp_request_duration_seconds_sum{op=\"%s\"} %.9f\n",
+                   name, counters.latency_sum_ns.load() * 1e-9);
+            append(out, "myftp_request_duration_seconds_count{op=\"%s\"} %llu\n",
+                   name, static_cast<unsigned long long>(counters.count.load()));
+        }
+
+        out += "# TYPE myftp_request_duration_quantile_seconds gauge\n";
+        for (std::size_t op{0}; op < N_OPS; ++op)
+            for (double q : {0.5, 0.99, 0.999})
+                append(out,
+                       "myftp_request_duration_quantile_seconds{op=\"%s\","
+                       "quantile=\"%g\"} %.9f\n",
+                       OP_NAMES[op].data(), q,
+                       quantile(total->ops[op], q) * 1e-9);
+
+        if (cache)
+        {
+            out += "# TYPE myftp_cache_hits_total counter\n";
+            append(out, "myftp_cache_hits_total %llu\n",
+                   static_cast<unsigned long long>(cache->hits));
+            out += "# TYPE myftp_cache_misses_total counter\n";
+            append(out, "myftp_cache_misses_total %llu\n",
+                   static_cast<unsigned long long>(cache->misses));
+            out += "# TYPE myftp_cache_evictions_total counter\n";
+            append(out, "myftp_cache_evictions_total %llu\n",
+                   static_cast<unsigned long long>(cache->evictions));
+            out += "# TYPE myftp_cache_invalidations_total counter\n";
+            append(out, "myftp_cache_invalidations_total %llu\n",
+                   static_cast<unsigned long long>(cache->invalidations));
+            out += "# TYPE myftp_cache_entries gauge\n";
+            append(out, "myftp_cache_entries %zu\n", cache->entries);
+            out += "# TYPE myftp_cache_bytes gauge\n";
+            append(out, "myftp_cache_bytes %zu\n", cache->bytes);
+            out += "# TYPE myftp_cache_hit_ratio gauge\n";
+            append(out, "myftp_cache_hit_ratio %.6f\n", cache->hit_rate());
+        }
+
+        return out;
+    }
+}
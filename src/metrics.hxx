@@ -0,0 +1,36 @@
+#ifndef METRICS_HXX
+#define METRICS_HXX
+
+#include "file_cache.hxx"
+#include "file_copy.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class METRIC_OP : std::size_t
+{
+    OPEN,
+    LIST,
+    GET,
+    PUT,
+    SHA,
+    DELETE,
+    COPY,
+    MOVE,
+    COUNT
+};
+
+namespace metrics
+{
+    void record(METRIC_OP op, std::uint64_t latency_ns, bool is_ok);
+    void add_bytes_sent(std::uint64_t bytes);
+    void add_bytes_received(std::uint64_t bytes);
+    void copy_method_used(COPY_METHOD method);
+    void session_opened();
+    void session_closed();
+    const char *op_name(METRIC_OP op);
+
+    std::string render_prometheus(const file_cache::statistics *cache);
+}
+
+#endif
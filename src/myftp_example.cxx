@@ -0,0 +1,57 @@
+#include "async_client.hxx"
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static myftp::task<void> fetch(myftp::event_loop &loop, const char *host,
+                               const char *port, std::string name,
+                               bool &is_ok)
+{
+    auto client{co_await myftp::session::open(loop, host, port)};
+    if (!client)
+    {
+        std::fprintf(stderr, "%s: cannot connect\n", name.c_str());
+        is_ok = false;
+        co_return;
+    }
+
+    myftp::TRANSFER_STATUS status{co_await client->get(name, name, true)};
+    if (status != myftp::TRANSFER_STATUS::OK)
+    {
+        std::fprintf(stderr, "%s: download failed\n", name.c_str());
+        is_ok = false;
+    }
+    else
+    {
+        myftp::text_reply reply{co_await client->sha256(name)};
+        std::fputs(reply.text.c_str(), stdout);
+    }
+    co_await client->quit();
+}
+
+static myftp::task<void> fetch_all(myftp::event_loop &loop, int argc,
+                                   char *argv[], bool &is_ok)
+{
+    std::vector<myftp::task<void>> downloads;
+    for (int i{3}; i < argc; ++i)
+        downloads.push_back(fetch(loop, argv[1], argv[2], argv[i], is_ok));
+    co_await myftp::when_all(std::move(downloads));
+}
+
+int main(int argc, char *argv[])
+{
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (argc < 4)
+    {
+        std::fprintf(stderr, "Usage: %s <ip> <port> <file>...\n", argv[0]);
+        return 1;
+    }
+
+    bool is_ok{true};
+    myftp::event_loop loop;
+    loop.spawn(fetch_all(loop, argc, argv, is_ok));
+    loop.run();
+    return is_ok ? 0 : 1;
+}
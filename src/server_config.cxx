@@ -0,0 +1,78 @@
+#include "server_config.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+
+[[nodiscard]] static bool parse_option(std::string_view option,
+                                       server_config &config)
+{
+    if (option == "--direct-io")
+    {
+        config.direct_io.enabled = true;
+        return true;
+    }
+    if (option == "--huge-pages")
+    {
+        config.huge_pages = true;
+        return true;
+    }
+    if (option == "--trace")
+    {
+        config.trace = true;
+        return true;
+    }
+
+    auto equal{option.find('=')};
+    if (equal == std::string_view::npos)
+        return false;
+
+    std::string_view name{option.substr(0, equal)};
+    std::string_view value{option.substr(equal + 1)};
+
+    if (name == "--cache-size")
+        return parse_size(value, config.cache_size);
+    if (name == "--cache-max-entry")
+        return parse_size(value, config.cache_max_entry_size);
+    if (name == "--readahead")
+        return parse_size(value, config.read_hint.readahead_window);
+    if (name == "--drop-behind")
+        return parse_size(value, config.read_hint.drop_behind_threshold);
+    if (name == "--io-buffer")
+        return parse_size(value, config.io_buffer_size) &&
+               config.io_buffer_size >= BUF_SIZE;
+    if (name == "--io-buffer-idle")
+        return parse_size(value, config.io_buffer_max_idle);
+    if (name == "--sync-batch")
+        return parse_size(value, config.direct_io.sync_batch);
+    if (name == "--admin-socket")
+    {
+        config.admin_socket = value.data();
+        return !value.empty();
+    }
+    if (name == "--hash-threads")
+        return parse_size(value, config.hash_threads);
+    if (name == "--merkle-leaf")
+        return parse_size(value, config.merkle_leaf_size) &&
+               config.merkle_leaf_size > 0;
+    return false;
+}
+
+[[nodiscard]] bool parse_server_config(int argc, char *argv[],
+                                       server_config &config)
+{
+    if (argc < 3)
+        return false;
+
+    config.ip = argv[1];
+    config.port = argv[2];
+
+    for (int i{3}; i < argc; ++i)
+        if (!parse_option(argv[i], config))
+            return false;
+
+    if (config.hash_threads == 0)
+        config.hash_threads =
+            std::max(1u, std::thread::hardware_concurrency());
+    return true;
+}
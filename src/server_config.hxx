@@ -0,0 +1,33 @@
+#ifndef SERVER_CONFIG_HXX
+#define SERVER_CONFIG_HXX
+
+#include "direct_io.hxx"
+#include "tools.hxx"
+#include <cstddef>
+
+struct server_config
+{
+    const char *ip = nullptr;
+    const char *port = nullptr;
+
+    std::size_t cache_size = 0;
+    std::size_t cache_max_entry_size = 256 << 10;
+
+    read_hints read_hint{};
+    direct_io_options direct_io{};
+
+    std::size_t io_buffer_size = 256 << 10;
+    std::size_t io_buffer_max_idle = 64;
+    bool huge_pages = false;
+
+    std::size_t hash_threads = 0;
+    std::size_t merkle_leaf_size = 1 << 20;
+
+    const char *admin_socket = nullptr;
+    bool trace = false;
+};
+
+[[nodiscard]] bool parse_server_config(int argc, char *argv[],
+                                       server_config &config);
+
+#endif
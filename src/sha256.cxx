@@ -0,0 +1,137 @@
+#include "sha256.hxx"
+#include <algorithm>
+#include <cstring>
+
+static constexpr std::array<std::uint32_t, 64> ROUND_CONSTANTS{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static constexpr std::array<std::uint32_t, 8> INITIAL_STATE{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static constexpr std::uint32_t rotate_right(std::uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+sha256_hasher::sha256_hasher() : m_state{INITIAL_STATE} {}
+
+void sha256_hasher::compress(const std::uint8_t *block)
+{
+    std::uint32_t w[64];
+    for (int i{0}; i < 16; ++i)
+        w[i] = static_cast<std::uint32_t>(block[4 * i]) << 24 |
+               static_cast<std::uint32_t>(block[4 * i + 1]) << 16 |
+               static_cast<std::uint32_t>(block[4 * i + 2]) << 8 |
+               static_cast<std::uint32_t>(block[4 * i + 3]);
+    for (int i{16}; i < 64; ++i)
+    {
+        std::uint32_t s0{rotate_right(w[i - 15], 7) ^
+                         rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3)};
+        std::uint32_t s1{rotate_right(w[i - 2], 17) ^
+                         rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10)};
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h]{m_state};
+    for (int i{0}; i < 64; ++i)
+    {
+        std::uint32_t s1{rotate_right(e, 6) ^ rotate_right(e, 11) ^
+                         rotate_right(e, 25)};
+        std::uint32_t ch{(e & f) ^ (~e & g)};
+        std::uint32_t t1{h + s1 + ch + ROUND_CONSTANTS[i] + w[i]};
+        std::uint32_t s0{rotate_right(a, 2) ^ rotate_right(a, 13) ^
+                         rotate_right(a, 22)};
+        std::uint32_t maj{(a & b) ^ (a & c) ^ (b & c)};
+        std::uint32_t t2{s0 + maj};
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void sha256_hasher::update(const void *data, std::size_t size)
+{
+    auto bytes{static_cast<const std::uint8_t *>(data)};
+    m_total_size += size;
+
+    if (m_block_size > 0)
+    {
+        std::size_t n{std::min(size, m_block.size() - m_block_size)};
+        std::memcpy(m_block.data() + m_block_size, bytes, n);
+        m_block_size += n;
+        bytes += n;
+        size -= n;
+
+        if (m_block_size < m_block.size())
+            return;
+        compress(m_block.data());
+        m_block_size = 0;
+    }
+
+    for (; size >= m_block.size(); bytes += 64, size -= 64)
+        compress(bytes);
+
+    std::memcpy(m_block.data(), bytes, size);
+    m_block_size = size;
+}
+
+[[nodiscard]] sha256_digest sha256_hasher::finish()
+{
+    std::uint64_t total_bits{m_total_size * 8};
+
+    std::uint8_t padding[72]{0x80};
+    std::size_t padding_size{(m_block_size < 56 ? 56 : 120) - m_block_size};
+    for (int i{0}; i < 8; ++i)
+        padding[padding_size + i] =
+            static_cast<std::uint8_t>(total_bits >> (56 - 8 * i));
+    update(padding, padding_size + 8);
+
+    sha256_digest digest;
+    for (std::size_t i{0}; i < m_state.size(); ++i)
+    {
+        digest[4 * i] = static_cast<std::uint8_t>(m_state[i] >> 24);
+        digest[4 * i + 1] = static_cast<std::uint8_t>(m_state[i] >> 16);
+        digest[4 * i + 2] = static_cast<std::uint8_t>(m_state[i] >> 8);
+        digest[4 * i + 3] = static_cast<std::uint8_t>(m_state[i]);
+    }
+    return digest;
+}
+
+std::string to_hex(const sha256_digest &digest)
+{
+    constexpr char HEX_DIGITS[]{"0123456789abcdef"};
+
+    std::string result(2 * digest.size(), '\0');
+    for (std::size_t i{0}; i < digest.size(); ++i)
+    {
+        result[2 * i] = HEX_DIGITS[digest[i] >> 4];
+        result[2 * i + 1] = HEX_DIGITS[digest[i] & 0xf];
+    }
+    return result;
+}
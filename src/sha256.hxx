@@ -0,0 +1,32 @@
+#ifndef SHA256_HXX
+#define SHA256_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+constexpr std::size_t SHA256_DIGEST_SIZE{32};
+
+using sha256_digest = std::array<std::uint8_t, SHA256_DIGEST_SIZE>;
+
+class sha256_hasher
+{
+private:
+    std::array<std::uint32_t, 8> m_state;
+    std::array<std::uint8_t, 64> m_block;
+    std::size_t m_block_size = 0;
+    std::uint64_t m_total_size = 0;
+
+    void compress(const std::uint8_t *block);
+
+public:
+    sha256_hasher();
+
+    void update(const void *data, std::size_t size);
+    [[nodiscard]] sha256_digest finish();
+};
+
+std::string to_hex(const sha256_digest &digest);
+
+#endif
@@ -1,10 +1,15 @@
 #include "socket.hxx"
 #include "error_handle.hxx"
 #include "file_process.hxx"
+#include <cerrno>
 #include <cstring>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 constexpr int optval{1};
@@ -51,6 +56,8 @@ static int open_listen_fd(const char *hostname, const char *port)
         {
             set_socket_option(listen_fd, SOL_SOCKET, SO_REUSEADDR, &optval,
                               sizeof(int));
+            set_socket_option(listen_fd, IPPROTO_TCP, TCP_NODELAY, &optval,
+                              sizeof(int));
 
             if (bind(listen_fd, ptr->ai_addr, ptr->ai_addrlen) == 0)
                 break;
@@ -90,7 +97,11 @@ static int open_client_fd(const char *hostname, const char *port)
             continue;
 
         if (connect(clientfd, p->ai_addr, p->ai_addrlen) != -1)
+        {
+            set_socket_option(clientfd, IPPROTO_TCP, TCP_NODELAY, &optval,
+                              sizeof(int));
             break;
+        }
         file_process::close(clientfd);
     }
 
@@ -101,6 +112,41 @@ static int open_client_fd(const char *hostname, const char *port)
     return clientfd;
 }
 
+static int open_unix_listen_fd(const char *path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    std::strcpy(addr.sun_path, path);
+
+    struct stat path_stat;
+    if (lstat(path, &path_stat) == 0)
+    {
+        if (!S_ISSOCK(path_stat.st_mode))
+        {
+            errno = EEXIST;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int listen_fd{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (listen_fd < 0)
+        return -1;
+
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr),
+             sizeof(sockaddr_un)) < 0 ||
+        listen(listen_fd, LISTEN_BACKLOG) < 0)
+    {
+        file_process::close(listen_fd);
+        return -1;
+    }
+
+    return listen_fd;
+}
+
 namespace socket_process
 {
     int open_listen_fd(const char *hostname, const char *port)
@@ -121,6 +167,15 @@ namespace socket_process
         return rc;
     }
 
+    int open_unix_listen_fd(const char *path)
+    {
+        int rc;
+
+        if ((rc = ::open_unix_listen_fd(path)) < 0)
+            error_handle::unix_error("Open_unix_listenfd error");
+        return rc;
+    }
+
     int accept(int s, sockaddr *addr, socklen_t *addrlen)
     {
         int rc;
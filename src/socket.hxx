@@ -7,6 +7,7 @@ namespace socket_process
 {
     int open_listen_fd(const char *hostname, const char *port);
     int open_client_fd(const char *hostname, const char *port);
+    int open_unix_listen_fd(const char *path);
     int accept(int s, sockaddr *addr, socklen_t *addrlen);
 }
 
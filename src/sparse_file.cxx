@@ -0,0 +1,225 @@
+#include "sparse_file.hxx"
+#include "file_process.hxx"
+#include "trace.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr std::size_t ZERO_BLOCK_SIZE{64 << 10};
+constexpr char ZERO_BLOCK[ZERO_BLOCK_SIZE]{};
+
+std::uint64_t sparse_map::data_size() const
+{
+    std::uint64_t size{0};
+    for (const file_extent &extent : extents)
+        size += extent.length;
+    return size;
+}
+
+std::uint64_t sparse_map::frame_size() const
+{
+    return MYFTP_HEAD_SIZE + SPARSE_HEADER_SIZE +
+           SPARSE_EXTENT_SIZE * extents.size() + data_size();
+}
+
+void sparse_map::encode(std::string &out) const
+{
+    append_big_endian(out, logical_size);
+    append_big_endian(out, static_cast<std::uint32_t>(extents.size()));
+    for (const file_extent &extent : extents)
+    {
+        append_big_endian(out, extent.offset);
+        append_big_endian(out, extent.length);
+    }
+}
+
+bool is_sparse(const struct stat &file_stat)
+{
+    return S_ISREG(file_stat.st_mode) &&
+           static_cast<std::uint64_t>(file_stat.st_blocks) * 512 <
+               static_cast<std::uint64_t>(file_stat.st_size);
+}
+
+[[nodiscard]] bool map_data_extents(int fd, std::uint64_t logical_size,
+                                    sparse_map &map)
+{
+    map.logical_size = logical_size;
+    map.extents.clear();
+
+    off_t offset{0};
+    while (static_cast<std::uint64_t>(offset) < logical_size)
+    {
+        off_t data{::lseek(fd, offset, SEEK_DATA)};
+        if (data < 0)
+        {
+            if (errno == ENXIO)
+                break;
+            return false;
+        }
+        off_t hole{::lseek(fd, data, SEEK_HOLE)};
+        if (hole < 0)
+            return false;
+        hole = std::min<off_t>(hole, logical_size);
+
+        if (map.extents.size() == MAX_SPARSE_EXTENTS)
+            return false;
+        map.extents.push_back({static_cast<std::uint64_t>(data),
+                               static_cast<std::uint64_t>(hole - data)});
+        offset = hole;
+    }
+
+    return map.frame_size() <= UINT32_MAX;
+}
+
+[[nodiscard]] bool decode_sparse_header(const char *data,
+                                        std::uint64_t &logical_size,
+                                        std::uint32_t &n_extents)
+{
+    logical_size = load_big_endian<std::uint64_t>(data);
+    n_extents = load_big_endian<std::uint32_t>(data + 8);
+    return n_extents <= MAX_SPARSE_EXTENTS;
+}
+
+[[nodiscard]] bool decode_sparse_extents(const char *data,
+                                         std::uint32_t n_extents,
+                                         std::uint64_t payload_length,
+                                         sparse_map &map)
+{
+    map.extents.resize(n_extents);
+
+    std::uint64_t end{0};
+    for (std::uint32_t i{0}; i < n_extents; ++i)
+    {
+        file_extent &extent{map.extents[i]};
+        extent.offset = load_big_endian<std::uint64_t>(
+            data + i * SPARSE_EXTENT_SIZE);
+        extent.length = load_big_endian<std::uint64_t>(
+            data + i * SPARSE_EXTENT_SIZE + 8);
+        if (extent.offset < end || extent.length > map.logical_size ||
+            extent.offset > map.logical_size - extent.length)
+            return false;
+        end = extent.offset + extent.length;
+    }
+
+    return SPARSE_HEADER_SIZE + SPARSE_EXTENT_SIZE * n_extents +
+               map.data_size() ==
+           payload_length;
+}
+
+void hash_zeros(sha256_hasher &hasher, std::uint64_t length)
+{
+    while (length > 0)
+    {
+        std::size_t chunk{
+            static_cast<std::size_t>(std::min<std::uint64_t>(length,
+                                                             ZERO_BLOCK_SIZE))};
+        hasher.update(ZERO_BLOCK, chunk);
+        length -= chunk;
+    }
+}
+
+[[nodiscard]] bool send_sparse_file(int fd_to_host, int file_fd,
+                                    const sparse_map &map, char *buf,
+                                    sha256_hasher *hasher, std::size_t buf_size)
+{
+    myftp_head head(MYFTP_HEAD_TYPE::SPARSE_DATA, 1,
+                    static_cast<std::uint32_t>(map.frame_size()));
+    std::string header;
+    map.encode(header);
+    if (!head.send(fd_to_host) ||
+        file_process::write(fd_to_host, header.data(), header.size()) !=
+            header.size())
+        return false;
+
+    std::uint64_t end{0};
+    for (const file_extent &extent : map.extents)
+    {
+        if (hasher)
+            hash_zeros(*hasher, extent.offset - end);
+
+        for (std::uint64_t done{0}; done < extent.length;)
+        {
+            std::size_t length{static_cast<std::size_t>(
+                std::min<std::uint64_t>(buf_size, extent.length - done))};
+            ssize_t n_read;
+            {
+                TRACE_SPAN("disk_read");
+                n_read = ::pread(file_fd, buf, length, extent.offset + done);
+                if (n_read <= 0)
+                    return false;
+            }
+
+            if (hasher)
+                hasher->update(buf, n_read);
+
+            TRACE_SPAN("net_write");
+            if (file_process::write(fd_to_host, buf, n_read) !=
+                static_cast<std::size_t>(n_read))
+                return false;
+            done += n_read;
+        }
+        end = extent.offset + extent.length;
+    }
+
+    if (hasher)
+        hash_zeros(*hasher, map.logical_size - end);
+    return true;
+}
+
+[[nodiscard]] bool receive_sparse_file(int fd_to_host, const char *path,
+                                       char *buf, std::size_t payload_length,
+                                       sha256_hasher *hasher,
+                                       std::size_t buf_size)
+{
+    char fixed[SPARSE_HEADER_SIZE];
+    sparse_map map;
+    std::uint32_t n_extents;
+    if (file_process::read(fd_to_host, fixed, SPARSE_HEADER_SIZE) !=
+            SPARSE_HEADER_SIZE ||
+        !decode_sparse_header(fixed, map.logical_size, n_extents))
+        return false;
+
+    std::string table(SPARSE_EXTENT_SIZE * n_extents, '\0');
+    if (file_process::read(fd_to_host, table.data(), table.size()) !=
+            table.size() ||
+        !decode_sparse_extents(table.data(), n_extents, payload_length, map))
+        return false;
+
+    file_descriptor file{
+        ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)};
+    if (!file.is_valid() || ::ftruncate(file.get(), map.logical_size) != 0)
+        return false;
+
+    std::uint64_t end{0};
+    for (const file_extent &extent : map.extents)
+    {
+        if (hasher)
+            hash_zeros(*hasher, extent.offset - end);
+
+        for (std::uint64_t done{0}; done < extent.length;)
+        {
+            std::size_t length{static_cast<std::size_t>(
+                std::min<std::uint64_t>(buf_size, extent.length - done))};
+            {
+                TRACE_SPAN("net_read");
+                if (file_process::read(fd_to_host, buf, length) != length)
+                    return false;
+            }
+
+            if (hasher)
+                hasher->update(buf, length);
+
+            TRACE_SPAN("disk_write");
+            if (::pwrite(file.get(), buf, length, extent.offset + done) !=
+                static_cast<ssize_t>(length))
+                return false;
+            done += length;
+        }
+        end = extent.offset + extent.length;
+    }
+
+    if (hasher)
+        hash_zeros(*hasher, map.logical_size - end);
+    return true;
+}
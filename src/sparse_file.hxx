@@ -0,0 +1,55 @@
+#ifndef SPARSE_FILE_HXX
+#define SPARSE_FILE_HXX
+
+#include "sha256.hxx"
+#include "tools.hxx"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+constexpr std::size_t SPARSE_HEADER_SIZE{8 + 4};
+constexpr std::size_t SPARSE_EXTENT_SIZE{8 + 8};
+constexpr std::size_t MAX_SPARSE_EXTENTS{1 << 16};
+
+struct file_extent
+{
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+struct sparse_map
+{
+    std::uint64_t logical_size;
+    std::vector<file_extent> extents;
+
+    std::uint64_t data_size() const;
+    std::uint64_t frame_size() const;
+    void encode(std::string &out) const;
+};
+
+bool is_sparse(const struct stat &file_stat);
+[[nodiscard]] bool map_data_extents(int fd, std::uint64_t logical_size,
+                                    sparse_map &map);
+
+[[nodiscard]] bool decode_sparse_header(const char *data,
+                                        std::uint64_t &logical_size,
+                                        std::uint32_t &n_extents);
+[[nodiscard]] bool decode_sparse_extents(const char *data,
+                                         std::uint32_t n_extents,
+                                         std::uint64_t payload_length,
+                                         sparse_map &map);
+
+void hash_zeros(sha256_hasher &hasher, std::uint64_t length);
+
+[[nodiscard]] bool send_sparse_file(int fd_to_host, int file_fd,
+                                    const sparse_map &map, char *buf,
+                                    sha256_hasher *hasher = nullptr,
+                                    std::size_t buf_size = BUF_SIZE);
+[[nodiscard]] bool receive_sparse_file(int fd_to_host, const char *path,
+                                       char *buf, std::size_t payload_length,
+                                       sha256_hasher *hasher = nullptr,
+                                       std::size_t buf_size = BUF_SIZE);
+
+#endif
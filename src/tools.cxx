@@ -1,12 +1,40 @@
 #include "tools.hxx"
 #include "file_process.hxx"
+#include "mapped_file.hxx"
+#include "sparse_file.hxx"
+#include "trace.hxx"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <arpa/inet.h>
+#include <cerrno>
+#include <charconv>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <string_view>
 #include <sys/types.h>
+#include <system_error>
+#include <unistd.h>
+
+static std::uint32_t load_magic_high()
+{
+    std::uint32_t value;
+    std::memcpy(&value, MYFTP_PROTOCOL.data(), sizeof(value));
+    return value;
+}
+
+static std::uint16_t load_magic_low()
+{
+    std::uint16_t value;
+    std::memcpy(&value, MYFTP_PROTOCOL.data() + sizeof(std::uint32_t),
+                sizeof(value));
+    return value;
+}
+
+static const std::uint32_t MAGIC_HIGH{load_magic_high()};
+static const std::uint16_t MAGIC_LOW{load_magic_low()};
 
 myftp_head::myftp_head(MYFTP_HEAD_TYPE type, unsigned char status,
                        std::uint32_t length_host_endian)
@@ -24,60 +52,97 @@ void myftp_head::pack(MYFTP_HEAD_TYPE type, unsigned char status,
     m_length = htonl(length_host_endian);
 }
 
-bool myftp_head::is_valid() const
+struct head_rule
 {
-    std::string_view protocol{m_protocol, 6};
-    if (protocol != MYFTP_PROTOCOL)
-        return false;
+    std::uint32_t min_length;
+    std::uint32_t max_length;
+    std::uint8_t min_status;
+    std::uint8_t max_status;
+};
 
-    switch (m_type)
-    {
-    case MYFTP_HEAD_TYPE::OPEN_CONNECTION_REQUEST:
-    case MYFTP_HEAD_TYPE::LIST_REQUEST:
-    case MYFTP_HEAD_TYPE::PUT_REPLY:
-    case MYFTP_HEAD_TYPE::QUIT_REQUEST:
-    case MYFTP_HEAD_TYPE::QUIT_REPLY:
-        if (get_length() != MYFTP_HEAD_SIZE)
-            return false;
-        break;
+static constexpr std::array<head_rule, 256> make_head_rules()
+{
+    constexpr head_rule FIXED{MYFTP_HEAD_SIZE, MYFTP_HEAD_SIZE, 0, 0xff};
+    constexpr head_rule WITH_PAYLOAD{14, 0xffffffff, 0, 0xff};
+    constexpr head_rule RESULT{MYFTP_HEAD_SIZE, MYFTP_HEAD_SIZE, 0, 1};
 
-    case MYFTP_HEAD_TYPE::OPEN_CONNECTION_REPLY:
-        if (get_status() != 1 || get_length() != MYFTP_HEAD_SIZE)
-            return false;
-        break;
+    std::array<head_rule, 256> rules{};
+    rules.fill({0xffffffff, 0, 0xff, 0});
 
-    case MYFTP_HEAD_TYPE::LIST_REPLY:
-    case MYFTP_HEAD_TYPE::GET_REQUEST:
-    case MYFTP_HEAD_TYPE::PUT_REQUEST:
-    case MYFTP_HEAD_TYPE::SHA_REQUEST:
-        if (get_length() <= 13)
-            return false;
-        break;
+    auto set{[&](MYFTP_HEAD_TYPE type, head_rule rule)
+             { rules[static_cast<std::uint8_t>(type)] = rule; }};
 
-    case MYFTP_HEAD_TYPE::GET_REPLY:
-    case MYFTP_HEAD_TYPE::SHA_REPLY:
-        if ((get_status() != 0 && get_status() != 1) ||
-            get_length() != MYFTP_HEAD_SIZE)
-            return false;
+    set(MYFTP_HEAD_TYPE::OPEN_CONNECTION_REQUEST, FIXED);
+    set(MYFTP_HEAD_TYPE::OPEN_CONNECTION_REPLY,
+        {MYFTP_HEAD_SIZE, MYFTP_HEAD_SIZE, 1, 1});
+    set(MYFTP_HEAD_TYPE::LIST_REQUEST, FIXED);
+    set(MYFTP_HEAD_TYPE::LIST_REPLY, WITH_PAYLOAD);
+    set(MYFTP_HEAD_TYPE::GET_REQUEST,
+        {MYFTP_HEAD_SIZE + 2, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::GET_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::PUT_REQUEST,
+        {MYFTP_HEAD_SIZE + 2, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::PUT_REPLY, FIXED);
+    set(MYFTP_HEAD_TYPE::SHA_REQUEST,
+        {MYFTP_HEAD_SIZE + 2, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::SHA_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::QUIT_REQUEST, FIXED);
+    set(MYFTP_HEAD_TYPE::QUIT_REPLY, FIXED);
+    set(MYFTP_HEAD_TYPE::STATS_REQUEST, FIXED);
+    set(MYFTP_HEAD_TYPE::STATS_REPLY, WITH_PAYLOAD);
+    set(MYFTP_HEAD_TYPE::META_LIST_REQUEST,
+        {MYFTP_HEAD_SIZE + 1, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::META_LIST_REPLY,
+        {MYFTP_HEAD_SIZE, 0xffffffff, 0, 1});
+    set(MYFTP_HEAD_TYPE::DELETE_REQUEST,
+        {MYFTP_HEAD_SIZE + 2, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::DELETE_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::COPY_REQUEST,
+        {MYFTP_HEAD_SIZE + 4, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::COPY_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::MOVE_REQUEST,
+        {MYFTP_HEAD_SIZE + 4, MYFTP_HEAD_SIZE + BUF_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::MOVE_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::SHA_BATCH_REQUEST,
+        {MYFTP_HEAD_SIZE + 2, MYFTP_HEAD_SIZE + MAX_SHA_BATCH_PAYLOAD, 0,
+         0xff});
+    set(MYFTP_HEAD_TYPE::SHA_BATCH_REPLY, RESULT);
+    set(MYFTP_HEAD_TYPE::SPARSE_DATA,
+        {MYFTP_HEAD_SIZE + SPARSE_HEADER_SIZE, 0xffffffff, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::FILE_DIGEST,
+        {MYFTP_HEAD_SIZE + SHA256_DIGEST_SIZE,
+         MYFTP_HEAD_SIZE + SHA256_DIGEST_SIZE, 0, 0xff});
+    set(MYFTP_HEAD_TYPE::FILE_DATA, {MYFTP_HEAD_SIZE, 0xffffffff, 0, 0xff});
 
-    case MYFTP_HEAD_TYPE::FILE_DATA:
-        if (get_length() < MYFTP_HEAD_SIZE)
-            return false;
-        break;
+    return rules;
+}
 
-    default:
-        return false;
-    }
+static constexpr std::array<head_rule, 256> HEAD_RULES{make_head_rules()};
 
-    return true;
+bool myftp_head::is_valid() const
+{
+    return parse().type != MYFTP_HEAD_TYPE::INVALID;
 }
 
-MYFTP_HEAD_TYPE myftp_head::get_type() const
+myftp_head_view myftp_head::parse() const
 {
-    if (is_valid())
-        return m_type;
-    return MYFTP_HEAD_TYPE::INVALID;
+    std::uint32_t magic_high;
+    std::uint16_t magic_low;
+    std::memcpy(&magic_high, m_protocol, sizeof(magic_high));
+    std::memcpy(&magic_low, m_protocol + sizeof(magic_high), sizeof(magic_low));
+
+    std::uint32_t length{ntohl(m_length)};
+    const head_rule &rule{HEAD_RULES[static_cast<std::uint8_t>(m_type)]};
+
+    bool is_ok{static_cast<bool>(
+        (magic_high == MAGIC_HIGH) & (magic_low == MAGIC_LOW) &
+        (length >= rule.min_length) & (length <= rule.max_length) &
+        (m_status >= rule.min_status) & (m_status <= rule.max_status))};
+
+    return {is_ok ? m_type : MYFTP_HEAD_TYPE::INVALID, m_status, length};
 }
+
+MYFTP_HEAD_TYPE myftp_head::get_type() const { return parse().type; }
 unsigned char myftp_head::get_status() const { return m_status; }
 std::uint32_t myftp_head::get_length() const { return ntohl(m_length); }
 std::uint32_t myftp_head::get_payload_length() const
@@ -97,6 +162,33 @@ std::uint32_t myftp_head::get_payload_length() const
                                MYFTP_HEAD_SIZE) == MYFTP_HEAD_SIZE;
 }
 
+myftp_digest_trailer::myftp_digest_trailer(const sha256_digest &digest)
+    : m_head{MYFTP_HEAD_TYPE::FILE_DIGEST, 1, MYFTP_DIGEST_TRAILER_SIZE},
+      m_digest{digest}
+{
+}
+
+const sha256_digest &myftp_digest_trailer::get_digest() const
+{
+    return m_digest;
+}
+
+[[nodiscard]] bool myftp_digest_trailer::get(int fd_to_host)
+{
+    return file_process::read(fd_to_host, reinterpret_cast<char *>(this),
+                              MYFTP_DIGEST_TRAILER_SIZE) ==
+               MYFTP_DIGEST_TRAILER_SIZE &&
+           m_head.get_type() == MYFTP_HEAD_TYPE::FILE_DIGEST;
+}
+
+[[nodiscard]] bool myftp_digest_trailer::send(int fd_to_host) const
+{
+    return file_process::write(fd_to_host,
+                               reinterpret_cast<const char *>(this),
+                               MYFTP_DIGEST_TRAILER_SIZE) ==
+           MYFTP_DIGEST_TRAILER_SIZE;
+}
+
 FILE_ptr::FILE_ptr(std::FILE *ptr) : m_ptr{ptr} {}
 bool FILE_ptr::is_valid() const { return m_ptr != nullptr; }
 std::FILE *FILE_ptr::get_ptr() { return m_ptr; }
@@ -106,52 +198,169 @@ FILE_ptr::~FILE_ptr()
         std::fclose(m_ptr);
 }
 
-[[nodiscard]] bool send_file(int fd_to_host, const char *path, char *buf,
-                             std::size_t file_size)
+file_descriptor::file_descriptor(int fd) : m_fd{fd} {}
+bool file_descriptor::is_valid() const { return m_fd >= 0; }
+int file_descriptor::get() const { return m_fd; }
+file_descriptor::~file_descriptor()
 {
-    FILE_ptr file_stream{std::fopen(path, "rb")};
-    if (!file_stream.is_valid())
+    if (is_valid())
+        file_process::close(m_fd);
+}
+
+[[nodiscard]] static bool send_buffered_file(int fd_to_host, const char *path,
+                                             char *buf, std::size_t buf_size,
+                                             std::size_t file_size,
+                                             sha256_hasher *hasher)
+{
+    file_descriptor file{::open(path, O_RDONLY | O_CLOEXEC)};
+    if (!file.is_valid())
         return false;
 
     std::size_t n_sended_byte{0};
 
     while (n_sended_byte != file_size)
     {
-        std::size_t nread_bytes{
-            std::fread(buf, sizeof(char), BUF_SIZE, file_stream.get_ptr())};
+        std::size_t length{std::min(buf_size, file_size - n_sended_byte)};
+        {
+            TRACE_SPAN("disk_read");
+            if (file_process::read(file.get(), buf, length) != length)
+                return false;
+        }
+
+        if (hasher)
+            hasher->update(buf, length);
 
-        if (file_process::write(fd_to_host, buf, nread_bytes) < 0)
+        TRACE_SPAN("net_write");
+        if (file_process::write(fd_to_host, buf, length) != length)
             return false;
 
-        n_sended_byte += nread_bytes;
+        n_sended_byte += length;
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool send_file(int fd_to_host, const char *path, char *buf,
+                             std::size_t file_size, const read_hints &hints,
+                             sha256_hasher *hasher, std::size_t buf_size)
+{
+    mapped_file file{path, file_size};
+    if (!file.is_valid())
+        return send_buffered_file(fd_to_host, path, buf, buf_size, file_size,
+                                  hasher);
+
+    std::size_t window{std::max(hints.readahead_window, buf_size)};
+    bool drop_behind{file_size >= hints.drop_behind_threshold};
+
+    file.advise_sequential();
+    file.will_need(0, window);
+
+    for (std::size_t offset{0}; offset < file_size; offset += window)
+    {
+        std::size_t length{std::min(window, file_size - offset)};
+        if (file.is_truncated_before(offset + length))
+            return false;
+
+        file.will_need(offset + window, window);
+
+        if (hasher)
+            hasher->update(file.data() + offset, length);
+
+        TRACE_SPAN("net_write");
+        if (file_process::write(fd_to_host, file.data() + offset, length) !=
+            length)
+            return false;
+
+        if (drop_behind)
+            file.dont_need(offset, length);
     }
 
     return true;
 }
 
 [[nodiscard]] bool receive_file(int fd_to_host, const char *path, char *buf,
-                                std::size_t file_size)
+                                std::size_t file_size, sha256_hasher *hasher,
+                                std::size_t buf_size)
 {
-    FILE_ptr file_stream{std::fopen(path, "wb")};
-    if (!file_stream.is_valid())
+    file_descriptor file{
+        ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)};
+    if (!file.is_valid())
         return false;
 
     std::size_t n_received_byte{0};
 
     while (n_received_byte != file_size)
     {
-        std::size_t nread_bytes{file_process::read(
-            fd_to_host, buf, std::min(BUF_SIZE, file_size - n_received_byte))};
+        std::size_t length{std::min(buf_size, file_size - n_received_byte)};
+        {
+            TRACE_SPAN("net_read");
+            if (file_process::read(fd_to_host, buf, length) != length)
+                return false;
+        }
 
-        if (nread_bytes < 0)
-            return false;
+        if (hasher)
+            hasher->update(buf, length);
 
-        if (std::fwrite(buf, sizeof(char), nread_bytes,
-                        file_stream.get_ptr()) != nread_bytes)
+        TRACE_SPAN("disk_write");
+        if (file_process::write(file.get(), buf, length) != length)
             return false;
 
-        n_received_byte += nread_bytes;
+        n_received_byte += length;
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool receive_digest_trailer(int fd_to_host,
+                                          const sha256_digest &expected,
+                                          bool &is_matched)
+{
+    myftp_digest_trailer trailer;
+    if (!trailer.get(fd_to_host))
+        return false;
+
+    is_matched = trailer.get_digest() == expected;
+    return true;
+}
+
+[[nodiscard]] int create_temporary_file(const std::string &target,
+                                        mode_t mode, std::string &path)
+{
+    static std::atomic<unsigned> sequence{0};
+    for (int attempt{0}; attempt < 16; ++attempt)
+    {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", ::getpid(),
+                      sequence.fetch_add(1, std::memory_order_relaxed));
+        path = target + suffix;
+        int fd{::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                      mode)};
+        if (fd >= 0 || errno != EEXIST)
+            return fd;
     }
+    return -1;
+}
 
+[[nodiscard]] bool parse_size(std::string_view text, std::size_t &size)
+{
+    std::size_t value;
+    auto [end, ec]{
+        std::from_chars(text.data(), text.data() + text.size(), value)};
+    if (ec != std::errc{})
+        return false;
+
+    std::string_view suffix{end,
+                            static_cast<std::size_t>(text.data() +
+                                                     text.size() - end)};
+    if (suffix.empty())
+        size = value;
+    else if (suffix == "K" || suffix == "k")
+        size = value << 10;
+    else if (suffix == "M" || suffix == "m")
+        size = value << 20;
+    else if (suffix == "G" || suffix == "g")
+        size = value << 30;
+    else
+        return false;
     return true;
 }
@@ -1,11 +1,15 @@
 #ifndef TOOLS_HXX
 #define TOOLS_HXX
 
+#include "sha256.hxx"
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <regex>
+#include <string>
 #include <string_view>
+#include <sys/types.h>
+#include <type_traits>
 
 constexpr std::size_t MAGIC_NUMBER_LENGTH{6};
 
@@ -43,9 +47,38 @@ enum class MYFTP_HEAD_TYPE : std::uint8_t
     QUIT_REQUEST = 0xab,
     QUIT_REPLY = 0xac,
 
+    STATS_REQUEST = 0xad,
+    STATS_REPLY = 0xae,
+
+    META_LIST_REQUEST = 0xaf,
+    META_LIST_REPLY = 0xb0,
+
+    DELETE_REQUEST = 0xb1,
+    DELETE_REPLY = 0xb2,
+
+    COPY_REQUEST = 0xb3,
+    COPY_REPLY = 0xb4,
+
+    MOVE_REQUEST = 0xb5,
+    MOVE_REPLY = 0xb6,
+
+    SHA_BATCH_REQUEST = 0xb7,
+    SHA_BATCH_REPLY = 0xb8,
+
+    SPARSE_DATA = 0xFD,
+    FILE_DIGEST = 0xFE,
     FILE_DATA = 0xFF,
 };
 
+constexpr std::uint8_t MYFTP_FLAG_DIGEST_TRAILER{0x02};
+constexpr std::uint8_t MYFTP_FLAG_MERKLE_TREE{0x04};
+constexpr std::uint8_t MYFTP_FLAG_SPARSE{0x08};
+constexpr std::uint8_t MYFTP_FLAG_RECURSIVE{0x10};
+
+constexpr std::size_t MAX_SHA_BATCH_PAYLOAD{1 << 20};
+
+struct myftp_head_view;
+
 class [[gnu::packed]] myftp_head
 {
 private:
@@ -63,6 +96,8 @@ public:
     void pack(MYFTP_HEAD_TYPE type, std::uint8_t status,
               std::uint32_t length_host_endian);
 
+    myftp_head_view parse() const;
+
     MYFTP_HEAD_TYPE get_type() const;
     std::uint8_t get_status() const;
     std::uint32_t get_length() const;
@@ -72,6 +107,22 @@ public:
     [[nodiscard]] bool send(int fd_to_host) const;
 };
 
+class [[gnu::packed]] myftp_digest_trailer
+{
+private:
+    myftp_head m_head;
+    sha256_digest m_digest;
+
+public:
+    myftp_digest_trailer(const sha256_digest &digest);
+    myftp_digest_trailer() = default;
+
+    const sha256_digest &get_digest() const;
+
+    [[nodiscard]] bool get(int fd_to_host);
+    [[nodiscard]] bool send(int fd_to_host) const;
+};
+
 class FILE_ptr
 {
 private:
@@ -84,13 +135,74 @@ public:
     ~FILE_ptr();
 };
 
+class file_descriptor
+{
+private:
+    int m_fd = -1;
+
+public:
+    file_descriptor(int fd);
+    file_descriptor(const file_descriptor &) = delete;
+    file_descriptor &operator=(const file_descriptor &) = delete;
+    bool is_valid() const;
+    int get() const;
+    ~file_descriptor();
+};
+
 constexpr std::size_t MYFTP_HEAD_SIZE{sizeof(myftp_head)};
 static_assert(MYFTP_HEAD_SIZE == 12);
 
+struct myftp_head_view
+{
+    MYFTP_HEAD_TYPE type;
+    std::uint8_t status;
+    std::uint32_t length;
+
+    std::uint32_t payload_length() const { return length - MYFTP_HEAD_SIZE; }
+};
+constexpr std::size_t MYFTP_DIGEST_TRAILER_SIZE{sizeof(myftp_digest_trailer)};
+static_assert(MYFTP_DIGEST_TRAILER_SIZE == MYFTP_HEAD_SIZE + SHA256_DIGEST_SIZE);
+
+struct read_hints
+{
+    std::size_t readahead_window = 1 << 20;
+    std::size_t drop_behind_threshold = 64 << 20;
+};
+
 [[nodiscard]] bool send_file(int fd_to_host, const char *path, char *buf,
-                             std::size_t size);
+                             std::size_t size, const read_hints &hints = {},
+                             sha256_hasher *hasher = nullptr,
+                             std::size_t buf_size = BUF_SIZE);
 [[nodiscard]] bool receive_file(int fd_to_host, const char *path, char *buf,
-                                std::size_t size);
+                                std::size_t size,
+                                sha256_hasher *hasher = nullptr,
+                                std::size_t buf_size = BUF_SIZE);
+[[nodiscard]] bool receive_digest_trailer(int fd_to_host,
+                                          const sha256_digest &expected,
+                                          bool &is_matched);
+
+// Creates a fresh `<target>.<pid>.<n>.tmp` next to `target` so a failed
+// write never touches the file that is already there. Returns -1 on error.
+[[nodiscard]] int create_temporary_file(const std::string &target,
+                                        mode_t mode, std::string &path);
+
+[[nodiscard]] bool parse_size(std::string_view text, std::size_t &size);
+
+template <typename T> void append_big_endian(std::string &out, T value)
+{
+    auto bits{static_cast<std::make_unsigned_t<T>>(value)};
+    for (std::size_t i{sizeof(T)}; i-- > 0;)
+        out += static_cast<char>(bits >> (8 * i));
+}
+
+template <typename T> T load_big_endian(const char *data)
+{
+    std::make_unsigned_t<T> bits{0};
+    for (std::size_t i{0}; i < sizeof(T); ++i)
+        bits = static_cast<std::make_unsigned_t<T>>(
+            (bits << 8) | static_cast<std::uint8_t>(data[i]));
+    return static_cast<T>(bits);
+}
 
 const myftp_head
     OPEN_CONNECTION_REQUEST(MYFTP_HEAD_TYPE::OPEN_CONNECTION_REQUEST, 1,
@@ -106,12 +218,39 @@ const myftp_head GET_REPLY_SUCCESS(MYFTP_HEAD_TYPE::GET_REPLY, 1,
 const myftp_head GET_REPLY_FAIL(MYFTP_HEAD_TYPE::GET_REPLY, 0, MYFTP_HEAD_SIZE);
 
 const myftp_head PUT_REPLY(MYFTP_HEAD_TYPE::PUT_REPLY, 1, MYFTP_HEAD_SIZE);
+const myftp_head PUT_REPLY_FAIL(MYFTP_HEAD_TYPE::PUT_REPLY, 0, MYFTP_HEAD_SIZE);
+const myftp_head PUT_REPLY_SPARSE(MYFTP_HEAD_TYPE::PUT_REPLY,
+                                  1 | MYFTP_FLAG_SPARSE, MYFTP_HEAD_SIZE);
 
 const myftp_head SHA_REPLAY_SUCCESS(MYFTP_HEAD_TYPE::SHA_REPLY, 1,
                                     MYFTP_HEAD_SIZE);
 const myftp_head SHA_REPLAY_FAIL(MYFTP_HEAD_TYPE::SHA_REPLY, 0,
                                  MYFTP_HEAD_SIZE);
 
+const myftp_head DELETE_REPLY_SUCCESS(MYFTP_HEAD_TYPE::DELETE_REPLY, 1,
+                                      MYFTP_HEAD_SIZE);
+const myftp_head DELETE_REPLY_FAIL(MYFTP_HEAD_TYPE::DELETE_REPLY, 0,
+                                   MYFTP_HEAD_SIZE);
+
+const myftp_head COPY_REPLY_SUCCESS(MYFTP_HEAD_TYPE::COPY_REPLY, 1,
+                                    MYFTP_HEAD_SIZE);
+const myftp_head COPY_REPLY_FAIL(MYFTP_HEAD_TYPE::COPY_REPLY, 0,
+                                 MYFTP_HEAD_SIZE);
+
+const myftp_head MOVE_REPLY_SUCCESS(MYFTP_HEAD_TYPE::MOVE_REPLY, 1,
+                                    MYFTP_HEAD_SIZE);
+const myftp_head MOVE_REPLY_FAIL(MYFTP_HEAD_TYPE::MOVE_REPLY, 0,
+                                 MYFTP_HEAD_SIZE);
+
+const myftp_head SHA_BATCH_REPLY_SUCCESS(MYFTP_HEAD_TYPE::SHA_BATCH_REPLY, 1,
+                                         MYFTP_HEAD_SIZE);
+const myftp_head SHA_BATCH_REPLY_FAIL(MYFTP_HEAD_TYPE::SHA_BATCH_REPLY, 0,
+                                      MYFTP_HEAD_SIZE);
+const myftp_head SHA_BATCH_END(MYFTP_HEAD_TYPE::FILE_DATA, 1, MYFTP_HEAD_SIZE);
+
+const myftp_head STATS_REQUEST(MYFTP_HEAD_TYPE::STATS_REQUEST, 1,
+                               MYFTP_HEAD_SIZE);
+
 const myftp_head QUIT_REQUEST(MYFTP_HEAD_TYPE::QUIT_REQUEST, 1,
                               MYFTP_HEAD_SIZE);
 const myftp_head QUIT_REPLY(MYFTP_HEAD_TYPE::QUIT_REPLY, 1, MYFTP_HEAD_SIZE);
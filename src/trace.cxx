@@ -0,0 +1,173 @@
+#include "trace.hxx"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+constexpr std::size_t TRACE_RING_SIZE{1 << 12};
+constexpr std::size_t MAX_RETIRED_RINGS{64};
+
+struct trace_event
+{
+    std::atomic<const char *> name;
+    std::atomic<std::uint64_t> start_ns;
+    std::atomic<std::uint64_t> end_ns;
+};
+
+struct trace_ring
+{
+    pid_t tid;
+    std::atomic<std::uint64_t> head;
+    std::array<trace_event, TRACE_RING_SIZE> events;
+};
+
+struct event_copy
+{
+    const char *name;
+    std::uint64_t start_ns;
+    std::uint64_t end_ns;
+    pid_t tid;
+};
+
+// Each ring has a single writer. A reader copies the published window and
+// then drops the slots the writer may have reused while it was copying.
+static void copy_events(const trace_ring &ring, std::vector<event_copy> &out)
+{
+    std::uint64_t end{ring.head.load(std::memory_order_acquire)};
+    std::uint64_t begin{end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0};
+
+    std::size_t first{out.size()};
+    for (std::uint64_t i{begin}; i < end; ++i)
+    {
+        const trace_event &event{ring.events[i % TRACE_RING_SIZE]};
+        out.push_back({event.name.load(std::memory_order_relaxed),
+                       event.start_ns.load(std::memory_order_relaxed),
+                       event.end_ns.load(std::memory_order_relaxed),
+                       ring.tid});
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t after{ring.head.load(std::memory_order_relaxed)};
+    std::uint64_t valid{after + 1 > TRACE_RING_SIZE
+                            ? after + 1 - TRACE_RING_SIZE
+                            : 0};
+    if (valid > begin)
+        out.erase(out.begin() + first,
+                  out.begin() + first +
+                      std::min<std::uint64_t>(valid - begin, end - begin));
+}
+
+class ring_registry
+{
+private:
+    std::mutex m_mutex;
+    std::unordered_set<trace_ring *> m_live;
+    std::deque<std::unique_ptr<trace_ring>> m_retired;
+
+public:
+    void attach(trace_ring *ring)
+    {
+        std::lock_guard lock{m_mutex};
+        m_live.insert(ring);
+    }
+
+    void retire(std::unique_ptr<trace_ring> ring)
+    {
+        std::lock_guard lock{m_mutex};
+        m_live.erase(ring.get());
+        m_retired.push_back(std::move(ring));
+        if (m_retired.size() > MAX_RETIRED_RINGS)
+            m_retired.pop_front();
+    }
+
+    void snapshot(std::vector<event_copy> &out)
+    {
+        std::lock_guard lock{m_mutex};
+        for (const auto &ring : m_retired)
+            copy_events(*ring, out);
+        for (const trace_ring *ring : m_live)
+            copy_events(*ring, out);
+    }
+};
+
+static ring_registry rings;
+
+class thread_ring
+{
+private:
+    std::unique_ptr<trace_ring> m_ring{std::make_unique<trace_ring>()};
+
+public:
+    thread_ring()
+    {
+        m_ring->tid = ::gettid();
+        rings.attach(m_ring.get());
+    }
+    ~thread_ring() { rings.retire(std::move(m_ring)); }
+    trace_ring &get() { return *m_ring; }
+};
+
+namespace trace
+{
+    void set_enabled(bool is_enabled)
+    {
+        is_enabled_flag.store(is_enabled, std::memory_order_relaxed);
+    }
+
+    std::uint64_t now_ns()
+    {
+        timespec now;
+        ::clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000 +
+               now.tv_nsec;
+    }
+
+    void record(const char *name, std::uint64_t start_ns,
+                std::uint64_t end_ns)
+    {
+        thread_local thread_ring instance;
+        trace_ring &ring{instance.get()};
+
+        std::uint64_t index{ring.head.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_release);
+
+        trace_event &event{ring.events[index % TRACE_RING_SIZE]};
+        event.name.store(name, std::memory_order_relaxed);
+        event.start_ns.store(start_ns, std::memory_order_relaxed);
+        event.end_ns.store(end_ns, std::memory_order_relaxed);
+        ring.head.store(index + 1, std::memory_order_release);
+    }
+
+    std::string render_chrome_json()
+    {
+        std::vector<event_copy> events;
+        rings.snapshot(events);
+        std::sort(events.begin(), events.end(),
+                  [](const event_copy &a, const event_copy &b)
+                  { return a.start_ns < b.start_ns; });
+
+        pid_t pid{::getpid()};
+        std::string out{"{\"displayTimeUnit\":\"ns\",\"traceEvents\":["};
+        char line[256];
+        for (std::size_t i{0}; i < events.size(); ++i)
+        {
+            const event_copy &event{events[i]};
+            int n{std::snprintf(
+                line, sizeof(line),
+                "%s\n{\"name\":\"%s\",\"cat\":\"myftp\",\"ph\":\"X\","
+                "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                i == 0 ? "" : ",", event.name, pid, event.tid,
+                event.start_ns / 1e3, (event.end_ns - event.start_ns) / 1e3)};
+            out.append(line, std::min<std::size_t>(n, sizeof(line) - 1));
+        }
+        out += "\n]}\n";
+        return out;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef TRACE_HXX
+#define TRACE_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace trace
+{
+    inline std::atomic<bool> is_enabled_flag{false};
+
+    inline bool is_enabled()
+    {
+        return is_enabled_flag.load(std::memory_order_relaxed);
+    }
+
+    void set_enabled(bool is_enabled);
+    std::uint64_t now_ns();
+    void record(const char *name, std::uint64_t start_ns,
+                std::uint64_t end_ns);
+    std::string render_chrome_json();
+
+    class span
+    {
+    private:
+        const char *m_name;
+        std::uint64_t m_start_ns;
+
+    public:
+        explicit span(const char *name)
+            : m_name{is_enabled() ? name : nullptr},
+              m_start_ns{m_name ? now_ns() : 0}
+        {
+        }
+        span(const span &) = delete;
+        span &operator=(const span &) = delete;
+        ~span()
+        {
+            if (m_name)
+                record(m_name, m_start_ns, now_ns());
+        }
+    };
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SPAN(name) trace::span TRACE_CONCAT(trace_span_, __LINE__){name}
+
+#endif